@@ -13,6 +13,10 @@ void Tmpl8::Explosion::tick()
 
 void Tmpl8::Explosion::draw(Surface* screen)
 {
-    explosion_sprite->set_frame(current_frame / 2);
-    explosion_sprite->draw(screen, (int)position.x + HEALTHBAR_OFFSET, (int)position.y);
+    get_sprite_instance().draw(screen);
+}
+
+Tmpl8::SpriteInstance Tmpl8::Explosion::get_sprite_instance() const
+{
+    return {explosion_sprite, current_frame / 2, (int)position.x + HEALTHBAR_OFFSET, (int)position.y};
 }
@@ -11,6 +11,7 @@ class Explosion
     bool done() const;
     void tick();
     void draw(Surface* screen);
+    SpriteInstance get_sprite_instance() const;
 
     vec2 position;
 
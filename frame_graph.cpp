@@ -0,0 +1,99 @@
+#include "precomp.h"
+#include "frame_graph.h"
+
+namespace Tmpl8
+{
+void FrameGraph::add_stage(const uint32_t reads, const uint32_t writes, std::function<void()> function)
+{
+    const int index = (int)stages.size();
+    stages.push_back({reads, writes, std::move(function), {}, 0, 0});
+
+    //Write after write, read after write and write after read all keep the order they were added in
+    for (int earlier = 0; earlier < index; earlier++)
+    {
+        Stage& other = stages[earlier];
+        if ((other.writes & (reads | writes)) || (other.reads & writes))
+        {
+            other.successors.push_back(index);
+            stages[index].dependency_count++;
+        }
+    }
+}
+
+void FrameGraph::run(ThreadPool& pool)
+{
+    int ready_count;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        //Set before any stage is ready, a helper left over from last frame may already pick one up
+        remaining = (int)stages.size();
+        ready.clear();
+        for (int i = 0; i < (int)stages.size(); i++)
+        {
+            stages[i].pending = stages[i].dependency_count;
+            if (stages[i].pending == 0) ready.push_back(i);
+        }
+        ready_count = (int)ready.size();
+    }
+
+    start_helpers(pool, ready_count - 1);
+
+    //The calling thread runs stages as well, it only waits while the other threads hold the last stages
+    while (remaining > 0)
+    {
+        if (!run_ready_stage(pool))
+            std::this_thread::yield();
+    }
+}
+
+//Takes the first ready stage (in the order they were added) and runs it, false if none is ready
+bool FrameGraph::run_ready_stage(ThreadPool& pool)
+{
+    int index;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ready.empty()) return false;
+
+        const auto first = std::min_element(ready.begin(), ready.end());
+        index = *first;
+        ready.erase(first);
+    }
+
+    stages[index].function();
+
+    int newly_ready = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const int successor : stages[index].successors)
+        {
+            if (--stages[successor].pending == 0)
+            {
+                ready.push_back(successor);
+                newly_ready++;
+            }
+        }
+    }
+    remaining--;
+
+    //This thread continues with one of them, free workers can take the others
+    start_helpers(pool, newly_ready - 1);
+    return true;
+}
+
+void FrameGraph::start_helpers(ThreadPool& pool, const int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex_available_threads);
+        if (!pool.threads_available()) return;
+
+        pool.enqueue([this, &pool]
+        {
+            while (run_ready_stage(pool))
+            {
+            }
+        });
+    }
+}
+} // namespace Tmpl8
@@ -0,0 +1,41 @@
+#pragma once
+
+namespace Tmpl8
+{
+    // -----------------------------------------------------------
+    // Small job graph for the stages of a frame.
+    // Every stage declares the data it reads and writes as bit flags,
+    // a stage runs after every earlier stage that writes data it uses
+    // or uses data it writes, stages without such a conflict overlap.
+    // The graph is built once and run every frame.
+    // -----------------------------------------------------------
+    class FrameGraph
+    {
+    public:
+        void add_stage(uint32_t reads, uint32_t writes, std::function<void()> function);
+
+        //Runs all stages on the pool and the calling thread, returns when every stage is done
+        void run(ThreadPool& pool);
+
+    private:
+        struct Stage
+        {
+            uint32_t reads;
+            uint32_t writes;
+            std::function<void()> function;
+            std::vector<int> successors;
+            int dependency_count = 0;
+            int pending = 0; //Dependencies not done yet this frame
+        };
+
+        bool run_ready_stage(ThreadPool& pool);
+        void start_helpers(ThreadPool& pool, int count);
+
+        std::vector<Stage> stages;
+
+        //Lock for the ready list and the pending counts
+        std::mutex mutex;
+        std::vector<int> ready;
+        atomic<int> remaining = 0;
+    };
+} // namespace Tmpl8
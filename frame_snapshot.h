@@ -0,0 +1,34 @@
+#pragma once
+
+namespace Tmpl8
+{
+    //Sprite with the frame and screen position it is drawn at
+    struct SpriteInstance
+    {
+        Sprite* sprite;
+        int frame;
+        int x;
+        int y;
+
+        void draw(Surface* screen) const
+        {
+            sprite->set_frame(frame);
+            sprite->draw(screen, x, y);
+        }
+    };
+
+    // -----------------------------------------------------------
+    // Everything Game::draw needs of one simulated frame.
+    // Captured after the update, so the frame can be drawn while
+    // the next frame is simulated on the other threads.
+    // -----------------------------------------------------------
+    class FrameSnapshot
+    {
+    public:
+        //Tanks, rockets, smoke, particle beams and explosions in draw order
+        std::vector<SpriteInstance> sprites;
+        std::vector<vec2> forcefield_hull;
+        //Health of the least healthy tanks per team (indexed by allignment), lowest first
+        std::vector<int> lowest_health[2];
+    };
+} // namespace Tmpl8
@@ -13,6 +13,17 @@ constexpr auto health_bar_width = 70;
 
 constexpr auto max_frames = 2000;
 
+//Draw frame N from a snapshot while frame N + 1 is simulated, the screen then lags one frame behind the simulation
+constexpr auto pipelined_rendering = true;
+
+//Route search the tanks start with, the number keys switch it while running (see Game::key_down)
+constexpr auto default_pathfinder = Pathfinder::FLOW_FIELD;
+
+//Minimum number of tanks / rockets / routes per parallel_for chunk, smaller chunks cost more in scheduling than they win
+constexpr auto tank_grain = 64;
+constexpr auto rocket_grain = 128;
+constexpr auto route_grain = 16;
+
 //Global performance timer
 constexpr auto REF_PERFORMANCE = 389333; //UPDATE THIS WITH YOUR REFERENCE PERFORMANCE (see console after 2k frames)
 static timer perf_timer;
@@ -34,10 +45,9 @@ static Sprite rocket_blue(rocket_blue_img, 12);
 static Sprite smoke(smoke_img, 4);
 static Sprite explosion(explosion_img, 9);
 static Sprite particle_beam_sprite(particle_beam_img, 3);
-std::mutex mutex_tanks;
-std::mutex mutex_rockets;
 const static vec2 tank_size(7, 9);
-ThreadPool pool;
+//Frame stages follow each other within microseconds, so idle workers poll a little before they sleep
+ThreadPool pool({std::max(std::thread::hardware_concurrency(), 1u) - 1, IdlePolicy::SPIN_YIELD_PARK});
 static uint8_t tank_radius = 3;
 static uint8_t rocket_radius = 5;
 
@@ -50,7 +60,10 @@ void Game::init()
 {
     frame_count_font = new Font("assets/digital_small.png", "ABCDEFGHIJKLMNOPQRSTUVWXYZ:?!=-0123456789.");
 
+    set_pathfinder(default_pathfinder);
+
     tanks.reserve(num_tanks_blue + num_tanks_red);
+    tank_store.reserve(num_tanks_blue + num_tanks_red);
     constexpr uint max_rows = 24;
 
     const float start_blue_x = tank_size.x + 40.0f;
@@ -64,7 +77,7 @@ void Game::init()
     for (int i = 0; i < num_tanks_blue; i++)
     {
         const vec2 position{start_blue_x + ((i % max_rows) * spacing), start_blue_y + ((i / max_rows) * spacing)};
-        tanks.emplace_back(position.x, position.y, BLUE, &tank_blue, &smoke, 1100.f, position.y + 16, tank_max_health,
+        tanks.emplace_back(tank_store, position.x, position.y, BLUE, &tank_blue, &smoke, 1100.f, position.y + 16, tank_max_health,
                            tank_max_speed);
     }
     //Spawn red tanks
@@ -72,79 +85,122 @@ void Game::init()
     {
         constexpr float start_red_x = 1088.0f;
         const vec2 position{start_red_x + ((i % max_rows) * spacing), start_red_y + ((i / max_rows) * spacing)};
-        tanks.emplace_back(position.x, position.y, RED, &tank_red, &smoke, 100.f, position.y + 16, tank_max_health,
+        tanks.emplace_back(tank_store, position.x, position.y, RED, &tank_red, &smoke, 100.f, position.y + 16, tank_max_health,
                            tank_max_speed);
     }
 
     particle_beams.emplace_back(vec2(590, 327), vec2(100, 50), &particle_beam_sprite, particle_beam_hit_value);
     particle_beams.emplace_back(vec2(64, 64), vec2(100, 50), &particle_beam_sprite, particle_beam_hit_value);
     particle_beams.emplace_back(vec2(1200, 600), vec2(100, 50), &particle_beam_sprite, particle_beam_hit_value);
+
+    build_frame_graph();
+
+    //The first frame drawn while simulating is the starting state
+    capture_snapshot(snapshot);
+}
+
+// -----------------------------------------------------------
+// Registers the update stages in their serial order with the data they use
+// Stages that share no written data overlap, e.g. the smoke ticks with the tank stages and the hull
+// with the rocket update, the result is the same as running them one after the other
+// -----------------------------------------------------------
+void Game::build_frame_graph()
+{
+    frame_graph.add_stage(TANK_POSITIONS | TANK_HEALTH, TANK_FORCES | TEAM_GRIDS, [this] { collision(); });
+    frame_graph.add_stage(TANK_FORCES | TANK_HEALTH | TEAM_GRIDS, TANK_POSITIONS | TANK_FORCES | ROCKETS,
+                          [this] { update_tanks_multithreaded(); });
+
+    //Update smoke plumes
+    frame_graph.add_stage(0, SMOKES, [this]
+    {
+        for (Smoke& smoke : smokes)
+            smoke.tick();
+    });
+
+    //Calculate "forcefield" around active tanks
+    frame_graph.add_stage(TANK_POSITIONS | TANK_HEALTH, FORCEFIELD, [this]
+    {
+        forcefield_hull.clear();
+        convex_hull();
+    });
+
+    //Rockets move and find their hits, the tanks are only damaged in the next stage
+    frame_graph.add_stage(TANK_POSITIONS | TANK_HEALTH, TEAM_GRIDS | ROCKETS, [this] { update_rocket(); });
+    frame_graph.add_stage(TANK_POSITIONS | TEAM_GRIDS, TANK_HEALTH | ROCKETS | EXPLOSIONS | SMOKES,
+                          [this] { resolve_rocket_hits(); });
+
+    frame_graph.add_stage(FORCEFIELD, ROCKETS | EXPLOSIONS, [this] { rocket_hits_convex(); });
+
+    //Remove exploded rockets with remove erase idiom
+    frame_graph.add_stage(0, ROCKETS, [this]
+    {
+        rockets.erase(std::remove_if(rockets.begin(), rockets.end(), [](const Rocket& rocket) { return !rocket.active; }),
+                      rockets.end());
+    });
+
+    frame_graph.add_stage(TANK_POSITIONS | TEAM_GRIDS, TANK_HEALTH | SMOKES | PARTICLE_BEAMS,
+                          [this] { update_particle_beams(); });
+
+    //Update explosion sprites and remove when done with remove erase idiom
+    frame_graph.add_stage(0, EXPLOSIONS, [this]
+    {
+        for (Explosion& explosion : explosions)
+            explosion.tick();
+
+        explosions.erase(std::remove_if(explosions.begin(), explosions.end(),
+                                        [](const Explosion& explosion) { return explosion.done(); }), explosions.end());
+    });
 }
 
 
 void Game::update_tanks_multithreaded()
 {
-    int portion = tanks.size() / pool.get_thread_count();
-    int remainder = tanks.size() % pool.get_thread_count();
-    int end = 0;
-    std::vector<std::future<void>> futures;
-    for (int i = 0; i < pool.get_thread_count(); i++)
-    {
-        int start = end;
-        end += portion;
-        if (remainder > 0)
-        {
-            end++;
-            remainder--;
-        }
+    calculate_max_tank_step();
 
-        pool.mutex_available_threads.lock();
-        if (pool.threads_available())
-        {
-            futures.push_back(pool.enqueue([&, start, end]() { update_tanks_partial(start, end); }));
-            pool.mutex_available_threads.unlock();
-        }
-        else
-        {
-            pool.mutex_available_threads.unlock();
-            update_tanks_partial(start, end);
-        }
-    }
+    //Every chunk spawns its rockets in its own buffer, so no lock is needed on the rockets vector
+    //Only the active tanks are split, destroyed tanks would leave chunks idle
+    const int active_count = (int)tank_store.get_active_ids().size();
+    rocket_spawn_buffers.resize(pool.chunk_count(0, active_count, tank_grain));
+    for (vector<Rocket>& spawned : rocket_spawn_buffers)
+        spawned.clear();
 
-    for (int c = 0; c < futures.size(); c++)
+    pool.parallel_for(0, active_count, tank_grain, [this](const int start, const int end, const int chunk)
     {
-        futures.at(c).wait();
-    }
+        update_tanks_partial(start, end, rocket_spawn_buffers[chunk]);
+    });
+
+    //Merge the spawned rockets in chunk order, this keeps the rocket order the same as a serial update
+    size_t spawned_count = 0;
+    for (const vector<Rocket>& spawned : rocket_spawn_buffers)
+        spawned_count += spawned.size();
+
+    rockets.reserve(rockets.size() + spawned_count);
+    for (const vector<Rocket>& spawned : rocket_spawn_buffers)
+        rockets.insert(rockets.end(), spawned.begin(), spawned.end());
 }
 
 
-void Game::update_tanks_partial(int start, int end)
+//start and end index into the active ids, which are in tank order
+void Game::update_tanks_partial(int start, int end, vector<Rocket>& spawned_rockets)
 {
-    for (int c = start; c < end; c++)
+    const vector<int>& active_ids = tank_store.get_active_ids();
+    for (int i = start; i < end; i++)
     {
+        const int c = active_ids[i];
         Tank& tank = tanks.at(c);
-        if (tank.active)
+
+        //Move tanks according to speed and nudges (see above) also reload
+        //Only this portion writes to this tank, so no lock is needed
+        tank.tick(background_terrain);
+        //Shoot at closest target if reloaded
+        if (tank.rocket_reloaded())
         {
-            {
-                // prevent access violations to the tank list, lock_guard unlocks when out of scope
-                const std::lock_guard<std::mutex> guard_tank(mutex_tanks);
-                //Move tanks according to speed and nudges (see above) also reload
-                tank.tick(background_terrain);
-            }
-            //Shoot at closest target if reloaded
-            if (tank.rocket_reloaded())
-            {
-                Tank& target = find_closest_enemy(tank);
-                {
-                    // prevent access violations, lock_guard unlocks when out of scope
-                    const std::lock_guard<std::mutex> guard_rockets(mutex_rockets);
-                    rockets.push_back(
-                        Rocket(tank.position, (target.get_position() - tank.position).normalized() * 3,
-                               rocket_radius,
-                               tank.allignment, ((tank.allignment == RED) ? &rocket_red : &rocket_blue)));
-                }
-                tank.reload_rocket();
-            }
+            Tank& target = find_closest_enemy(tank);
+            const vec2 position = tank_store.position(c);
+            spawned_rockets.emplace_back(position, (target.get_position() - position).normalized() * 3,
+                                         rocket_radius, tank.allignment,
+                                         (tank.allignment == RED) ? &rocket_red : &rocket_blue);
+            tank.reload_rocket();
         }
     }
 }
@@ -157,150 +213,117 @@ void Game::shutdown()
 }
 
 // -----------------------------------------------------------
-// Iterates through all tanks and returns the closest enemy tank for the given tank
+// Returns the closest enemy tank for the given tank
+// Uses a ring search over the enemy team grid, the result is the same as a scan over all tanks
 // -----------------------------------------------------------
 Tank& Game::find_closest_enemy(const Tank& current_tank)
 {
-    float closest_distance = numeric_limits<float>::infinity();
-    int closest_index = 0;
-
-    for (int i = 0; i < tanks.size(); i++)
-    {
-        if (tanks.at(i).allignment != current_tank.allignment && tanks.at(i).active)
-        {
-            if (const float sqr_dist = fabsf((tanks.at(i).get_position() - current_tank.get_position()).dot());
-                sqr_dist < closest_distance)
-            {
-                closest_distance = sqr_dist;
-                closest_index = i;
-            }
-        }
-    }
+    const SpatialGrid& enemy_grid = team_grids[(current_tank.allignment == RED) ? BLUE : RED];
+    const int closest_index = enemy_grid.find_nearest(tank_store, current_tank.get_position(), max_tank_step);
 
-    return tanks.at(closest_index);
+    return tanks.at((closest_index >= 0) ? closest_index : 0);
 }
 
-/**
- * \brief sorts a vector with predicate
- * \tparam T Type within vector
- * \tparam Function Predicate Function type
- * \param original original vector
- * \param begin begin merge sort (usually 0)
- * \param end end merge sort
- * \param predicate function that takes two pointer arguments
- * \return sorted vector
- */
-template <typename T, typename Function>
-std::vector<T*> Tmpl8::Game::merge_sort(std::vector<T>& original, const int begin,
-                                        const int end, const Function predicate)
+//Checks if a point lies on the left of an arbitrary angled line
+bool Game::left_of_line(const vec2 line_start, const vec2 line_end, const vec2 point)
 {
-    if (const int num_tanks = end - begin; num_tanks < 2) //stop condition
-        return std::vector<T*>{&original.at(begin)};
-
-
-    const int mid = (begin + end) / 2;
-    std::vector<T*> left;
-    std::vector<T*> right;
-    pool.mutex_available_threads.lock();
-    if (pool.threads_available())
-    {
-        auto task = pool.enqueue([&original, mid, end, predicate]
-        {
-            return merge_sort(original, mid, end, predicate);
-        });
-        pool.mutex_available_threads.unlock();
-        left = merge_sort(original, begin, mid, predicate);
-        right = task.get();
-    }
-    else
-    {
-        pool.mutex_available_threads.unlock();
-        left = merge_sort<T, Function>(original, begin, mid, predicate);
-        right = merge_sort<T, Function>(original, mid, end, predicate);
-    }
-    return merge<T, Function>(left, right, predicate);
+    return ((line_end.x - line_start.x) * (point.y - line_start.y) - (line_end.y - line_start.y) * (point.x - line_start
+        .x)) < 0;
 }
 
-template <typename T, typename Function>
-std::vector<T*> Tmpl8::Game::merge(std::vector<T*> left, std::vector<T*> right,
-                                   const Function predicate)
+// -----------------------------------------------------------
+// Nudge overlapping tanks away from each other
+// Positions are not written during this stage and every tank only writes its own force,
+// so the portions run in parallel and the result does not depend on the thread count
+// -----------------------------------------------------------
+void Game::collision()
 {
-    std::vector<T*> result_vector;
-    result_vector.reserve(left.size() + right.size());
+    team_grids[BLUE].build(tank_store, BLUE);
+    team_grids[RED].build(tank_store, RED);
 
-    while (!left.empty() && !right.empty())
-    {
-        if (predicate(left[0], right[0]))
-        {
-            result_vector.emplace_back(left[0]);
-            left.erase(left.begin());
-            left.shrink_to_fit();
-        }
-        else
-        {
-            result_vector.emplace_back(right[0]);
-            right.erase(right.begin());
-            right.shrink_to_fit();
-        }
-    }
-    while (!left.empty() && right.empty())
-    {
-        result_vector.emplace_back(left[0]);
-        left.erase(left.begin());
+    const int active_count = (int)tank_store.get_active_ids().size();
+    collision_candidate_buffers.resize(pool.chunk_count(0, active_count, tank_grain));
 
-        left.shrink_to_fit();
-    }
-    while (left.empty() && !right.empty())
+    pool.parallel_for(0, active_count, tank_grain, [this](const int start, const int end, const int chunk)
     {
-        result_vector.emplace_back(right[0]);
-        right.erase(right.begin());
-
-        right.shrink_to_fit();
-    }
-
-    return result_vector;
+        collision_partial(start, end, collision_candidate_buffers[chunk]);
+    });
 }
 
-//Checks if a point lies on the left of an arbitrary angled line
-bool Game::left_of_line(const vec2 line_start, const vec2 line_end, const vec2 point)
+//start and end index into the active ids
+void Game::collision_partial(const int start, const int end, vector<int>& candidates)
 {
-    return ((line_end.x - line_start.x) * (point.y - line_start.y) - (line_end.y - line_start.y) * (point.x - line_start
-        .x)) < 0;
-}
+    const vector<int>& active_ids = tank_store.get_active_ids();
+
+    const uint8_t col_len = tank_radius << 1;
+    uint8_t col_squared_len = col_len;
+    col_squared_len *= col_squared_len;
 
-void Game::collision()
-{
     //Check tank collision and nudge tanks away from each other
-    for (Tank& tank : tanks)
+    for (int i = start; i < end; i++)
     {
-        if (tank.active)
+        const int id = active_ids[i];
+        const vec2 position = tank_store.position(id);
+
+        //Only tanks in the cells around this tank can be close enough to collide
+        candidates.clear();
+        for (const SpatialGrid& grid : team_grids)
         {
-            for (Tank& other_tank : tanks)
+            grid.for_each_in_box(position - vec2(col_len), position + vec2(col_len), [&](const int other)
             {
-                if (&tank == &other_tank || !other_tank.active) continue; //if tank is the same or dead continue
+                if (other != id) candidates.push_back(other);
+            });
+        }
 
-                vec2 dir = tank.get_position() - other_tank.get_position();
-                const float dir_squared_len = dir.dot();
+        //Push in tank order so the accumulated force is the same as a full scan
+        std::sort(candidates.begin(), candidates.end());
 
-                uint8_t col_squared_len = tank_radius << 1;
-                col_squared_len *= col_squared_len;
+        for (const int other : candidates)
+        {
+            vec2 dir = position - tank_store.position(other);
+            const float dir_squared_len = dir.dot();
 
-                if (dir_squared_len < col_squared_len)
-                {
-                    tank.push(dir.normalized(), 1.f);
-                }
+            if (dir_squared_len < col_squared_len)
+            {
+                tank_store.push(id, dir.normalized(), 1.f);
             }
         }
     }
 }
 
 
+// -----------------------------------------------------------
+// Largest distance a tank can move in Tank::tick with the forces of this frame
+// The team grids are built before the tanks move, so targeting needs this margin
+// -----------------------------------------------------------
+void Game::calculate_max_tank_step()
+{
+    const vector<int>& active_ids = tank_store.get_active_ids();
+    const auto chunk_max_step = [&](const int start, const int end)
+    {
+        float max_step = 0.f;
+        for (int i = start; i < end; i++)
+        {
+            const int id = active_ids[i];
+            max_step = std::max(max_step, (1.f + tank_store.force(id).length()) * tanks[id].max_speed * 0.5f);
+        }
+        return max_step;
+    };
+    const float max_step = pool.parallel_reduce(0, (int)active_ids.size(), tank_grain, 0.f, chunk_max_step,
+                                                [](const float a, const float b) { return std::max(a, b); });
+
+    //Direction is normalized, a small epsilon covers rounding in the grid distance bound
+    max_tank_step = max_step + 0.01f;
+}
+
 void Game::update_tanks()
 {
+    calculate_max_tank_step();
+
     //Update tanks
     for (Tank& tank : tanks)
     {
-        if (tank.active)
+        if (tank.is_active())
         {
             //Move tanks according to speed and nudges (see above) also reload
             tank.tick(background_terrain);
@@ -309,8 +332,9 @@ void Game::update_tanks()
             if (tank.rocket_reloaded())
             {
                 Tank& target = find_closest_enemy(tank);
+                const vec2 position = tank.get_position();
 
-                rockets.emplace_back(tank.position, (target.get_position() - tank.position).normalized() * 3,
+                rockets.emplace_back(position, (target.get_position() - position).normalized() * 3,
                                      rocket_radius, tank.allignment,
                                      tank.allignment == RED ? &rocket_red : &rocket_blue);
 
@@ -322,58 +346,80 @@ void Game::update_tanks()
 
 void Game::find_first_active_tank(uint16_t& first_active) const
 {
-    //Find first active tank (this loop is a bit disgusting, fix?)
-    for (const Tank& tank : tanks)
-    {
-        if (tank.active)
-            break;
-
-        first_active++;
-    }
+    //The active ids are in tank order, so the first one is the first active tank
+    const vector<int>& active_ids = tank_store.get_active_ids();
+    first_active += active_ids.empty() ? (uint16_t)tank_store.size() : (uint16_t)active_ids.front();
 }
 
 
-bool static convex_hull_pred(const Tank* t1, const Tank* t2)
+// -----------------------------------------------------------
+// Keep the active tank ids sorted on x for the convex hull
+// Tanks only move a little each frame, so the order of last frame is nearly sorted
+// and an insertion pass over it costs close to O(n)
+// -----------------------------------------------------------
+void Game::update_hull_order()
 {
-    return t1->position.x < t2->position.x;
+    //On equal x the higher id goes first, the same order the old merge sort gave the hull
+    const vector<float>& position_x = tank_store.position_x;
+    const auto before = [&position_x](const int id1, const int id2)
+    {
+        return position_x[id1] < position_x[id2] || (position_x[id1] == position_x[id2] && id1 > id2);
+    };
+
+    //Destroyed tanks are skipped by the hull, so they can be dropped from the order
+    hull_order.erase(std::remove_if(hull_order.begin(), hull_order.end(),
+                                    [this](const int id) { return !tank_store.is_active(id); }), hull_order.end());
+
+    if (hull_order.empty())
+    {
+        hull_order = tank_store.get_active_ids();
+        hull_sorter.sort(pool, hull_order, before);
+        return;
+    }
+
+    for (size_t i = 1; i < hull_order.size(); i++)
+    {
+        const int id = hull_order[i];
+        size_t j = i;
+        while (j > 0 && before(id, hull_order[j - 1]))
+        {
+            hull_order[j] = hull_order[j - 1];
+            j--;
+        }
+        hull_order[j] = id;
+    }
 }
 
 void Game::convex_hull()
 {
-    const vector<Tank*> sorted_tanks = merge_sort(tanks, 0, tanks.size(), convex_hull_pred);
+    update_hull_order();
 
     //upper hull
-    std::vector<vec2> upper_hull;
-    for (int i = 0; i < sorted_tanks.size(); ++i)
+    upper_hull.clear();
+    for (const int id : hull_order)
     {
-        const Tank* tank = sorted_tanks[i];
-
-        if (!tank->active) continue;
-
+        const vec2 position = tank_store.position(id);
         while (upper_hull.size() >= 2 && left_of_line(
-            upper_hull[upper_hull.size() - 2], upper_hull.back(), tank->position))
+            upper_hull[upper_hull.size() - 2], upper_hull.back(), position))
         {
             upper_hull.pop_back();
         }
 
-        upper_hull.push_back(tank->position);
+        upper_hull.push_back(position);
     }
 
 
     //lower hull
-    std::vector<vec2> lower_hull;
-    for (int i = sorted_tanks.size() - 1; i >= 0; --i)
+    lower_hull.clear();
+    for (int i = (int)hull_order.size() - 1; i >= 0; --i)
     {
-        const Tank* tank = sorted_tanks[i];
-
-        if (!tank->active) continue;
-
+        const vec2 position = tank_store.position(hull_order[i]);
         while (lower_hull.size() >= 2 && left_of_line(
-            lower_hull[lower_hull.size() - 2], lower_hull.back(), tank->position))
+            lower_hull[lower_hull.size() - 2], lower_hull.back(), position))
             lower_hull.pop_back();
 
 
-        lower_hull.push_back(tank->position);
+        lower_hull.push_back(position);
     }
 
     forcefield_hull.insert(forcefield_hull.end(), upper_hull.begin(), upper_hull.end());
@@ -382,82 +428,98 @@ void Game::convex_hull()
 
 void Game::update_rocket()
 {
-    //Update rockets
+    //The tanks have moved, rebuild the team grids for the rocket and particle beam hit tests
+    //(the particle beams run after the rockets and rely on these grids)
+    team_grids[BLUE].build(tank_store, BLUE);
+    team_grids[RED].build(tank_store, RED);
 
-    vector<future<void>> futures{};
-    auto portion = rockets.size() / pool.get_thread_count();
-    auto remainder = rockets.size() % pool.get_thread_count();
-    int end = 0;
+    //Update rockets, every chunk records its hits in its own buffer
+    const int rocket_count = (int)rockets.size();
+    rocket_hit_buffers.resize(pool.chunk_count(0, rocket_count, rocket_grain));
+    for (vector<RocketHit>& hits : rocket_hit_buffers)
+        hits.clear();
 
-    for (int i = 0; i < pool.get_thread_count(); i++)
+    pool.parallel_for(0, rocket_count, rocket_grain, [this](const int start, const int end, const int chunk)
     {
-        int start = end;
-        end += portion;
-        if (remainder > 0)
-        {
-            end++;
-            remainder--;
-        }
-
-        pool.mutex_available_threads.lock();
-        if (pool.threads_available())
-        {
-            futures.push_back(pool.enqueue([&, start, end]()
-            {
-                 update_rockets_partial(start, end);
-            }));
-            
-            pool.mutex_available_threads.unlock();
-        }
-        else
-        {
-            pool.mutex_available_threads.unlock();
-            update_rockets_partial(start, end);
-        }
-    }
-    for (auto& future : futures)
-        future.wait();
-    
+        update_rockets_partial(start, end, rocket_hit_buffers[chunk]);
+    });
 }
 
-void Game::update_rockets_partial(const int start, const int end)
+void Game::update_rockets_partial(const int start, const int end, vector<RocketHit>& hits)
 {
     for (int j = start; j < end; j++)
     {
+        //Every rocket belongs to exactly one portion, so ticking needs no lock
         Rocket& rocket = rockets[j];
+        rocket.tick();
+
+        //Only record the hit, the tanks are damaged in resolve_rocket_hits after all portions are done
+        if (const int hit_id = find_rocket_hit(rocket); hit_id >= 0)
+            hits.push_back({j, hit_id});
+    }
+}
+
+// -----------------------------------------------------------
+// Returns the first (lowest id) active enemy tank the rocket collides with, -1 if there is none
+// -----------------------------------------------------------
+int Game::find_rocket_hit(const Rocket& rocket) const
+{
+    //Only enemy tanks in the cells around the rocket can be hit
+    const SpatialGrid& enemy_grid = team_grids[(rocket.allignment == RED) ? BLUE : RED];
+    const float reach = (float)(rocket.collision_radius + tank_radius);
+    int hit_id = -1;
+    enemy_grid.for_each_in_box(rocket.position - vec2(reach), rocket.position + vec2(reach), [&](const int id)
+    {
+        if ((hit_id < 0 || id < hit_id) && tank_store.is_active(id) && rocket.intersects(
+            tank_store.position(id), tank_radius))
+            hit_id = id;
+    });
+
+    return hit_id;
+}
+
+// -----------------------------------------------------------
+// Applies the rocket hits of all portions in rocket order
+// Spawns an explosion per hit, and a smoke plume if the tank is destroyed
+// -----------------------------------------------------------
+void Game::resolve_rocket_hits()
+{
+    for (const vector<RocketHit>& hits : rocket_hit_buffers)
+    {
+        for (const RocketHit& hit : hits)
         {
-            const std::lock_guard<std::mutex> gaurd_rocket(mutex_rockets);
-            rocket.tick();
-        }
-        //Check if rocket collides with enemy tank, spawn explosion, and if tank is destroyed spawn a smoke plume
-        for (Tank& tank : tanks)
-        {
-            if (tank.active && (tank.allignment != rocket.allignment) && rocket.intersects(
-                tank.position, tank_radius))
-            {
-                const std::lock_guard<std::mutex> guard_tank(mutex_tanks);
-                explosions.emplace_back(&explosion, tank.position);
+            Rocket& rocket = rockets[hit.rocket_index];
 
-                if (tank.hit(rocket_hit_value))
-                    smokes.emplace_back(smoke, tank.position - vec2(7, 24));
+            //An earlier rocket may have destroyed the tank, the rocket then hits the next tank in reach (if any)
+            int tank_id = hit.tank_id;
+            if (!tank_store.is_active(tank_id))
+                tank_id = find_rocket_hit(rocket);
+            if (tank_id < 0) continue;
 
+            const vec2 position = tank_store.position(tank_id);
+            explosions.emplace_back(&explosion, position);
 
-                rocket.active = false;
-                break;
-            }
+            if (tank_store.hit(tank_id, rocket_hit_value))
+                smokes.emplace_back(smoke, position - vec2(7, 24));
+
+            rocket.active = false;
         }
     }
 }
 
 void Game::rocket_hits_convex()
 {
+    forcefield_query.build(forcefield_hull);
+
     //Disable rockets if they collide with the "forcefield"
-    //Hint: A point to convex hull intersection test might be better here? :) (Disable if outside)
     for (Rocket& rocket : rockets)
     {
         if (rocket.active)
         {
-            for (size_t i = 0; i < forcefield_hull.size(); i++)
+            //Only the edges within the angle the rocket covers (seen from inside the hull) can be hit
+            forcefield_query.find_candidate_edges(rocket.position, rocket.collision_radius, hull_edge_candidates);
+
+            for (const int i : hull_edge_candidates)
             {
                 if (circle_segment_intersect(forcefield_hull.at(i),
                                              forcefield_hull.at((i + 1) % forcefield_hull.size()), rocket.position,
@@ -478,12 +540,24 @@ void Game::update_particle_beams()
     {
         particle_beam.tick(tanks);
 
+        //Only tanks in the cells overlapping the damage window (grown by the tank radius) can be hit
+        const vec2 reach((float)tank_radius);
+        beam_candidates.clear();
+        for (const SpatialGrid& grid : team_grids)
+        {
+            grid.for_each_in_box(particle_beam.rectangle.min - reach, particle_beam.rectangle.max + reach,
+                                 [&](const int id) { beam_candidates.push_back(id); });
+        }
+
+        //Damage in tank order, so the smoke plumes spawn in the same order as a full scan
+        std::sort(beam_candidates.begin(), beam_candidates.end());
+
         //Damage all tanks within the damage window of the beam (the window is an axis-aligned bounding box)
-        for (Tank& tank : tanks)
+        for (const int id : beam_candidates)
         {
-            if (tank.active && particle_beam.rectangle.intersects_circle(
-                tank.get_position(), tank_radius) && tank.hit(particle_beam.damage))
-                smokes.emplace_back(smoke, tank.position - vec2(0, 48));
+            if (tank_store.is_active(id) && particle_beam.rectangle.intersects_circle(
+                tank_store.position(id), tank_radius) && tank_store.hit(id, particle_beam.damage))
+                smokes.emplace_back(smoke, tank_store.position(id) - vec2(0, 48));
         }
     }
 }
@@ -500,65 +574,67 @@ void Game::update()
     // collision_tanks(tanks, 0);
 
 
-    //Calculate the route to the destination for each tank using A*
+    //Calculate the route to the destination for each tank using the selected route search
     //Initializing routes here so it gets counted for performance..
-    if (frame_count == 0)
+    if (frame_count == 0 || routes_outdated)
     {
         calculate_route_multithreaded(tanks);
+        routes_outdated = false;
     }
 
 
-    collision();
-    update_tanks_multithreaded();
-
-    //Update smoke plumes
-    for (Smoke& smoke : smokes)
-        smoke.tick();
-
-
-    //Calculate "forcefield" around active tanks
-    forcefield_hull.clear();
-
-    //calculate convex hull
-    convex_hull();
+    //Tanks destroyed last frame are dropped from the active ids the stages iterate
+    tank_store.update_active_ids();
 
-    //update rocket
-    update_rocket();
+    //Runs collision, tanks, smoke, hull, rockets, hull hits, beams and explosions (see build_frame_graph)
+    frame_graph.run(pool);
 
     if (frame_count == 1)
     {
         printf("end");
     }
+}
 
-    //rocket hits convex
-    rocket_hits_convex();
+// -----------------------------------------------------------
+// Copies what draw needs of the current state into the snapshot
+// The vectors keep their capacity, so capturing does not allocate once they have grown
+// -----------------------------------------------------------
+void Game::capture_snapshot(FrameSnapshot& frame)
+{
+    frame.sprites.clear();
+    frame.sprites.reserve(tanks.size() + rockets.size() + smokes.size() + particle_beams.size() + explosions.size());
 
-    //Remove exploded rockets with remove erase idiom
-    rockets.erase(std::remove_if(rockets.begin(), rockets.end(), [](const Rocket& rocket) { return !rocket.active; }),
-                  rockets.end());
+    for (const Tank& tank : tanks)
+        frame.sprites.push_back(tank.get_sprite_instance());
 
-    //update particle beams
-    update_particle_beams();
+    for (const Rocket& rocket : rockets)
+        frame.sprites.push_back(rocket.get_sprite_instance());
 
-    //Update explosion sprites
-    for (Explosion& explosion : explosions)
-        explosion.tick();
+    for (const Smoke& smoke : smokes)
+        frame.sprites.push_back(smoke.get_sprite_instance());
 
-    //remove when done with remove erase idiom
-    explosions.erase(std::remove_if(explosions.begin(), explosions.end(),
-                                    [](const Explosion& explosion) { return explosion.done(); }), explosions.end());
-}
+    for (const Particle_beam& particle_beam : particle_beams)
+        frame.sprites.push_back(particle_beam.get_sprite_instance());
 
-static bool tank_merge_sort_pred(const Tank* t1, const Tank* t2)
-{
-    return t1->compare_health(*t2) <= 0;
+    for (const Explosion& explosion : explosions)
+        frame.sprites.push_back(explosion.get_sprite_instance());
+
+    frame.forcefield_hull = forcefield_hull;
+
+    //The health index is kept up to date by the tank store
+    for (int t = 0; t < 2; t++)
+    {
+        frame.lowest_health[t].clear();
+        for (const int id : tank_store.lowest_health((t < 1) ? BLUE : RED, SCRHEIGHT))
+            frame.lowest_health[t].push_back(tank_store.health[id]);
+    }
 }
 
 // -----------------------------------------------------------
 // Draw all sprites to the screen
 // (It is not recommended to multi-thread this function)
 // -----------------------------------------------------------
-void Game::draw()
+void Game::draw(const FrameSnapshot& frame)
 {
     // clear the graphics window
     screen->clear(0);
@@ -567,27 +643,14 @@ void Game::draw()
     background_terrain.draw(screen);
 
     //Draw sprites
-    for (int i = 0; i < num_tanks_blue + num_tanks_red; i++)
-        tanks.at(i).draw(screen);
-
-    for (Rocket& rocket : rockets)
-        rocket.draw(screen);
-
-
-    for (Smoke& smoke : smokes)
-        smoke.draw(screen);
-
-    for (Particle_beam& particle_beam : particle_beams)
-        particle_beam.draw(screen);
-
-    for (Explosion& explosion : explosions)
-        explosion.draw(screen);
+    for (const SpriteInstance& sprite : frame.sprites)
+        sprite.draw(screen);
 
     //Draw forcefield (mostly for debugging, its kinda ugly..)
-    for (size_t i = 0; i < forcefield_hull.size(); i++)
+    for (size_t i = 0; i < frame.forcefield_hull.size(); i++)
     {
-        vec2 line_start = forcefield_hull.at(i);
-        vec2 line_end = forcefield_hull.at((i + 1) % forcefield_hull.size());
+        vec2 line_start = frame.forcefield_hull.at(i);
+        vec2 line_end = frame.forcefield_hull.at((i + 1) % frame.forcefield_hull.size());
         line_start.x += HEALTHBAR_OFFSET;
         line_end.x += HEALTHBAR_OFFSET;
         screen->line(line_start, line_end, 0x0000ff);
@@ -595,54 +658,75 @@ void Game::draw()
 
     //Draw sorted health bars
     for (int t = 0; t < 2; t++)
-    {
-        const int num_tanks = ((t < 1) ? num_tanks_blue : num_tanks_red);
+        draw_health_bars(frame.lowest_health[t], t);
+}
 
-        const int begin = ((t < 1) ? 0 : num_tanks_blue);
-        std::vector<Tank*> sorted_tanks = merge_sort<Tank>(
-            tanks, begin, begin + num_tanks, tank_merge_sort_pred);
+void Game::calculate_route_multithreaded(vector<Tank>& t)
+{
+    if (pathfinder == Pathfinder::FLOW_FIELD)
+        build_flow_fields(t);
 
-        sorted_tanks.erase(std::remove_if(sorted_tanks.begin(), sorted_tanks.end(),
-                                          [](const Tank* tank) { return !tank->active; }), sorted_tanks.end());
+    pool.parallel_for(0, (int)t.size(), route_grain, [this, &t](const int start, const int end, int)
+    {
+        calc_route_singlethread(t, start, end);
+    });
 
-        draw_health_bars(sorted_tanks, t);
-    }
+    std::cout << "Route cache: " << route_cache.get_hits() << " hits, " << route_cache.get_misses() << " misses" << std::endl;
 }
 
-void Game::calculate_route_multithreaded(vector<Tank>& t)
+
+// -----------------------------------------------------------
+// Tanks only differ in their target row, so a few dozen target tiles cover all of them
+// Builds one field per distinct target tile instead of a search per tank, in parallel over the targets
+// -----------------------------------------------------------
+void Game::build_flow_fields(const vector<Tank>& t)
 {
-    int portion = tanks.size() / pool.get_thread_count();
-    std::vector<std::future<void>> futures;
-    for (size_t i = 0; i < pool.get_thread_count(); i++)
-    {
-        pool.mutex_available_threads.lock();
-        if (pool.threads_available())
-        {
-            futures.push_back(pool.enqueue([&t, i, portion] { calc_route_singlethread(t, i, portion); }));
-            pool.mutex_available_threads.unlock();
-        }
-        else
-        {
-            pool.mutex_available_threads.unlock();
-            calc_route_singlethread(tanks, i, portion);
-        }
-    }
+    flow_field_targets.clear();
+    for (const Tank& tank : t)
+        flow_field_targets.push_back(background_terrain.get_tile_index(tank.get_destination()));
 
-    for (auto& f : futures)
+    std::sort(flow_field_targets.begin(), flow_field_targets.end());
+    flow_field_targets.erase(std::unique(flow_field_targets.begin(), flow_field_targets.end()), flow_field_targets.end());
+    flow_fields.resize(flow_field_targets.size());
+
+    pool.parallel_for(0, (int)flow_fields.size(), 1, [this](const int start, const int end, int)
     {
-        f.wait();
-    }
+        for (int i = start; i < end; i++)
+            background_terrain.build_flow_field(flow_field_targets[i], flow_fields[i]);
+    });
 }
 
-
-//position is the portion it has to calculate
-void Tmpl8::Game::calc_route_singlethread(vector<Tank>& tanks, const int& position, const int& portion)
+//start and end are the range of tanks this call calculates the routes for
+//Every search keeps its state per thread, so every chunk searches the background terrain
+void Tmpl8::Game::calc_route_singlethread(vector<Tank>& tanks, const int start, const int end)
 {
-    Terrain terrain;
-    const int start = position * portion;
-    for (size_t i = 0; i < portion; i++)
+    for (int i = start; i < end; i++)
     {
-        tanks[start + i].set_route(terrain.a_star(tanks[start + i], tanks[start + i].target));
+        const Tank& tank = tanks[i];
+        const vec2 destination = tank.get_destination();
+        const int target = background_terrain.get_tile_index(destination);
+
+        //Routes only depend on the start and target tile, tanks that share both share the search
+        const RouteCache::Route route = route_cache.find_or_add(background_terrain.get_tile_index(tank.get_position()), target, [&]
+        {
+            if (pathfinder == Pathfinder::FLOW_FIELD)
+            {
+                const size_t field = std::lower_bound(flow_field_targets.begin(), flow_field_targets.end(), target) - flow_field_targets.begin();
+                return background_terrain.follow_flow_field(tank, flow_fields[field]);
+            }
+            if (pathfinder == Pathfinder::JUMP_POINT)
+            {
+                return background_terrain.jump_point_search(tank, destination);
+            }
+            if (pathfinder == Pathfinder::HIERARCHICAL)
+            {
+                return background_terrain.hierarchical_search(tank, destination);
+            }
+
+            return background_terrain.a_star(tank, destination);
+        });
+
+        tanks[i].set_route(*route);
     }
 }
 
@@ -679,9 +763,9 @@ void Tmpl8::Game::insertion_sort_tanks_health(const std::vector<Tank>& original,
 }
 
 // -----------------------------------------------------------
-// Draw the health bars based on the given tanks health values
+// Draw the health bars based on the given tanks health values (lowest first)
 // -----------------------------------------------------------
-void Tmpl8::Game::draw_health_bars(const std::vector<Tank*>& sorted_tanks, const int team) const
+void Tmpl8::Game::draw_health_bars(const std::vector<int>& health_values, const int team) const
 {
     const int health_bar_start_x = (team < 1) ? 0 : (SCRWIDTH - HEALTHBAR_OFFSET) - 1;
     const int health_bar_end_x = (team < 1) ? health_bar_width : health_bar_start_x + health_bar_width - 1;
@@ -696,14 +780,14 @@ void Tmpl8::Game::draw_health_bars(const std::vector<Tank*>& sorted_tanks, const
     }
 
     //Draw the <SCRHEIGHT> least healthy tank health bars
-    const int draw_count = std::min(SCRHEIGHT, (int)sorted_tanks.size());
+    const int draw_count = std::min(SCRHEIGHT, (int)health_values.size());
     for (int i = 0; i < draw_count - 1; i++)
     {
         //Health bars are 1 pixel each
         const int health_bar_start_y = i * 1;
         const int health_bar_end_y = health_bar_start_y + 1;
 
-        const float health_fraction = (1 - ((double)sorted_tanks[i]->health / (double)tank_max_health));
+        const float health_fraction = (1 - ((double)health_values[i] / (double)tank_max_health));
 
         if (team == 0)
         {
@@ -755,11 +839,37 @@ void Tmpl8::Game::measure_performance()
 // -----------------------------------------------------------
 void Game::tick()
 {
-    if (!lock_update)
+    if (pipelined_rendering && !lock_update)
+    {
+        //Simulate the next frame on the pool while this thread draws the last one from its snapshot
+        TaskLatch simulated;
+        bool simulating = false;
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex_available_threads);
+            if (pool.threads_available())
+            {
+                pool.enqueue([this] { update(); }, &simulated);
+                simulating = true;
+            }
+        }
+
+        if (!simulating)
+            update();
+
+        draw(snapshot);
+        pool.wait(simulated);
+
+        capture_snapshot(snapshot);
+    }
+    else
     {
-        update();
+        if (!lock_update)
+        {
+            update();
+        }
+        capture_snapshot(snapshot);
+        draw(snapshot);
     }
-    draw();
 
     measure_performance();
 
@@ -11,30 +11,41 @@ namespace Tmpl8
     class Game
     {
     public:
+        //Rocket that collided with a tank during the parallel rocket update
+        struct RocketHit
+        {
+            int rocket_index;
+            int tank_id;
+        };
+
         void set_target(Surface* surface) { screen = surface; }
         void init();
         void update_tanks_multithreaded();
-        void update_tanks_partial(int start, int end);
+        void update_tanks_partial(int start, int end, vector<Rocket>& spawned_rockets);
         static void shutdown();
         void update_rockets_multithreaded();
-        void update_rockets_partial(int start, int end);
+        void update_rockets_partial(int start, int end, vector<RocketHit>& hits);
         void update();
-        static void calc_route_singlethread(vector<Tank>& t,const int& position,const int& portion);void draw();
+        void calc_route_singlethread(vector<Tank>& t, int start, int end);
+        void capture_snapshot(FrameSnapshot& frame);
+        void draw(const FrameSnapshot& frame);
         void tick();void calculate_route_multithreaded(vector<Tank>& t);
+        void build_flow_fields(const vector<Tank>& t);
+        //Route search for the tank routes, the tanks plan their routes again on the next frame
+        void set_pathfinder(const Pathfinder search)
+        {
+            //The searches don't always find the same route, so the routes of the previous one are dropped
+            pathfinder = search;
+            route_cache.clear();
+            routes_outdated = true;
+        }
         static void insertion_sort_tanks_health(const std::vector<Tank>& original,
                                                 std::vector<const Tank*>& sorted_tanks, int begin, int end);
-        void draw_health_bars(const std::vector<Tank*>& sorted_tanks, const int team) const;
+        void draw_health_bars(const std::vector<int>& health_values, const int team) const;
         void measure_performance();
 
         Tank& find_closest_enemy(const Tank& current_tank);
 
-        template <typename T, typename Function> //perhaps delete const for predicate later if needed
-        static std::vector<T*> merge_sort(std::vector<T>& original, int begin, int end,
-                                                       const Function predicate);
-        template <typename T, typename Function> //perhaps delete const for predicate later if needed
-        static std::vector<T*> merge(std::vector<T*> left, std::vector<T*> right,
-                                     const Function predicate);
-
         void mouse_up(int button)
         {
             /* implement if you want to detect mouse button presses */
@@ -57,20 +68,73 @@ namespace Tmpl8
 
         void key_down(int key)
         {
-            /* implement if you want to handle keys */
+            //1 - 4 switch the route search
+            if (key == SDL_SCANCODE_1) set_pathfinder(Pathfinder::A_STAR);
+            if (key == SDL_SCANCODE_2) set_pathfinder(Pathfinder::FLOW_FIELD);
+            if (key == SDL_SCANCODE_3) set_pathfinder(Pathfinder::JUMP_POINT);
+            if (key == SDL_SCANCODE_4) set_pathfinder(Pathfinder::HIERARCHICAL);
         }
 
     private:
         Surface* screen;
 
         vector<Tank> tanks;
+        TankStore tank_store;
         vector<Rocket> rockets;
+        //Rockets spawned by each portion of update_tanks_multithreaded, merged after the stage
+        vector<vector<Rocket>> rocket_spawn_buffers;
+        //Hits found by each portion of update_rocket, applied in resolve_rocket_hits
+        vector<vector<RocketHit>> rocket_hit_buffers;
         vector<Smoke> smokes;
         vector<Explosion> explosions;
         vector<Particle_beam> particle_beams;
 
         Terrain background_terrain;
+        Pathfinder pathfinder = Pathfinder::FLOW_FIELD;
+        //Set when the route search changed, update then plans every route again
+        bool routes_outdated = false;
+        //Distinct target tiles (sorted) and their flow fields
+        std::vector<int> flow_field_targets;
+        std::vector<FlowField> flow_fields;
+        //Routes by start and target tile, kept between route calculations
+        RouteCache route_cache;
         std::vector<vec2> forcefield_hull;
+        HullQuery forcefield_query;
+        std::vector<int> hull_edge_candidates;
+
+        //Active tanks per team (indexed by allignment), rebuilt every frame before the tanks move
+        SpatialGrid team_grids[2]{
+            {16.f, (float)(SCRWIDTH - HEALTHBAR_OFFSET * 2), (float)SCRHEIGHT},
+            {16.f, (float)(SCRWIDTH - HEALTHBAR_OFFSET * 2), (float)SCRHEIGHT}
+        };
+        //Scratch buffer with the collision candidates of each portion
+        std::vector<std::vector<int>> collision_candidate_buffers;
+        //Active tank ids sorted on x, kept between frames for the incremental hull update
+        std::vector<int> hull_order;
+        MergeSorter<int> hull_sorter;
+        std::vector<vec2> upper_hull;
+        std::vector<vec2> lower_hull;
+        std::vector<int> beam_candidates;
+        //Upper bound on how far a tank moves this frame, widens the targeting search of the team grids
+        float max_tank_step = 0.f;
+
+        //Data the frame stages read and write, the frame graph keeps stages that share data in order
+        enum FrameData : uint32_t
+        {
+            TANK_POSITIONS = 1 << 0, //Also the rest of the per tank state Tank::tick changes
+            TANK_FORCES = 1 << 1,
+            TANK_HEALTH = 1 << 2, //Health, active bits and the health rankings
+            TEAM_GRIDS = 1 << 3,
+            ROCKETS = 1 << 4,
+            SMOKES = 1 << 5,
+            EXPLOSIONS = 1 << 6,
+            FORCEFIELD = 1 << 7,
+            PARTICLE_BEAMS = 1 << 8
+        };
+        FrameGraph frame_graph;
+
+        //Last simulated frame, drawn while the next frame is simulated when pipelined_rendering is on
+        FrameSnapshot snapshot;
 
         Font* frame_count_font;
         long long frame_count = 0;
@@ -79,12 +143,18 @@ namespace Tmpl8
 
         //Checks if a point lies on the left of an arbitrary angled line
         static bool left_of_line(vec2 line_start, vec2 line_end, vec2 point);
+        void build_frame_graph();
         void collision();
+        void collision_partial(int start, int end, vector<int>& candidates);
+        void calculate_max_tank_step();
         void update_tanks();
         void find_first_active_tank(uint16_t& first_active) const;
+        void update_hull_order();
         void convex_hull();
         void calculate_convex_hull();
         void update_rocket();
+        int find_rocket_hit(const Rocket& rocket) const;
+        void resolve_rocket_hits();
         void rocket_hits_convex();
         void update_particle_beams();
         void collision_tanks(vector<Tank>* tankies, uint8_t depth);
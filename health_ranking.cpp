@@ -0,0 +1,105 @@
+#include "precomp.h"
+#include "health_ranking.h"
+
+namespace Tmpl8
+{
+int HealthRanking::add(const int id, const int health)
+{
+    const int slot = (int)slot_ids.size();
+    slot_ids.push_back(id);
+    slot_health.push_back(-1);
+
+    insert(slot, health);
+    return slot;
+}
+
+void HealthRanking::update(const int slot, const int health)
+{
+    //Removed slots stay removed
+    if (slot_health[slot] < 0 || slot_health[slot] == health) return;
+
+    erase(slot);
+    insert(slot, health);
+}
+
+void HealthRanking::remove(const int slot)
+{
+    if (slot_health[slot] < 0) return;
+
+    erase(slot);
+}
+
+void HealthRanking::insert(const int slot, int health)
+{
+    health = std::max(health, 0);
+
+    //Buckets grow on demand, so the ranking does not need to know the max health
+    if (health >= (int)bucket_counts.size())
+    {
+        bucket_bits.resize(health + 1);
+        bucket_counts.resize(health + 1, 0);
+        non_empty_buckets.resize((health + 64) / 64, 0);
+    }
+
+    std::vector<uint64_t>& bits = bucket_bits[health];
+    if ((slot >> 6) >= (int)bits.size())
+        bits.resize((slot >> 6) + 1, 0);
+
+    bits[slot >> 6] |= uint64_t(1) << (slot & 63);
+    if (bucket_counts[health]++ == 0)
+        non_empty_buckets[health >> 6] |= uint64_t(1) << (health & 63);
+
+    slot_health[slot] = health;
+    dirty = true;
+}
+
+void HealthRanking::erase(const int slot)
+{
+    const int health = slot_health[slot];
+
+    bucket_bits[health][slot >> 6] &= ~(uint64_t(1) << (slot & 63));
+    if (--bucket_counts[health] == 0)
+        non_empty_buckets[health >> 6] &= ~(uint64_t(1) << (health & 63));
+
+    slot_health[slot] = -1;
+    dirty = true;
+}
+
+const std::vector<int>& HealthRanking::lowest(const int count)
+{
+    //Nothing changed since the last call, reuse the ranking
+    if (dirty || ranked_count != count)
+    {
+        collect_lowest(count);
+        ranked_count = count;
+        dirty = false;
+    }
+
+    return ranked_ids;
+}
+
+//Walks the non-empty buckets from low to high health and the slots within each bucket in tank order
+void HealthRanking::collect_lowest(const int count)
+{
+    ranked_ids.clear();
+
+    for (size_t bucket_word = 0; bucket_word < non_empty_buckets.size(); bucket_word++)
+    {
+        for (uint64_t buckets = non_empty_buckets[bucket_word]; buckets != 0; buckets &= buckets - 1)
+        {
+            const int health = (int)(bucket_word * 64) + lowest_bit(buckets);
+            const std::vector<uint64_t>& bits = bucket_bits[health];
+
+            for (size_t slot_word = 0; slot_word < bits.size(); slot_word++)
+            {
+                for (uint64_t slots = bits[slot_word]; slots != 0; slots &= slots - 1)
+                {
+                    if ((int)ranked_ids.size() == count) return;
+
+                    ranked_ids.push_back(slot_ids[slot_word * 64 + lowest_bit(slots)]);
+                }
+            }
+        }
+    }
+}
+} // namespace Tmpl8
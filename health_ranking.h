@@ -0,0 +1,44 @@
+#pragma once
+
+namespace Tmpl8
+{
+    // -----------------------------------------------------------
+    // Health index of the active tanks of one team, kept up to date
+    // on every hit and deactivation instead of sorting every frame.
+    // Every health value has a bucket with a bit per tank slot, so
+    // reading the lowest health tanks walks the non-empty buckets
+    // in order and the slots within a bucket in tank order: the
+    // same order as a stable sort on health.
+    // The ranking is cached and only rebuilt after a change.
+    // -----------------------------------------------------------
+    class HealthRanking
+    {
+    public:
+        //Adds an active tank and returns its slot, slots have to be added in tank order
+        int add(int id, int health);
+        void update(int slot, int health);
+        void remove(int slot);
+
+        //Ids of (at most) count active tanks with the lowest health, lowest first
+        const std::vector<int>& lowest(int count);
+
+    private:
+        void insert(int slot, int health);
+        void erase(int slot);
+        void collect_lowest(int count);
+
+        std::vector<int> slot_ids;
+        //Current bucket of each slot, -1 once removed
+        std::vector<int> slot_health;
+
+        //bucket_bits[health] has a bit per slot, bucket_counts[health] the number of set bits
+        std::vector<std::vector<uint64_t>> bucket_bits;
+        std::vector<int> bucket_counts;
+        //Bit per bucket that holds at least one slot
+        std::vector<uint64_t> non_empty_buckets;
+
+        std::vector<int> ranked_ids;
+        int ranked_count = -1;
+        bool dirty = true;
+    };
+} // namespace Tmpl8
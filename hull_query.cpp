@@ -0,0 +1,124 @@
+#include "precomp.h"
+#include "hull_query.h"
+
+namespace Tmpl8
+{
+constexpr float two_pi = 2.f * PI;
+
+void HullQuery::build(const std::vector<vec2>& hull)
+{
+    edge_count = (int)hull.size();
+
+    //Twice the signed area, its sign tells the orientation of the hull
+    float area = 0.f;
+    center = vec2(0.f);
+    for (int i = 0; i < edge_count; i++)
+    {
+        const vec2& a = hull[i];
+        const vec2& b = hull[(i + 1) % edge_count];
+        area += a.x * b.y - b.x * a.y;
+        center += a;
+    }
+
+    degenerate = (edge_count < 3) || (fabsf(area) < 1.f);
+    if (degenerate) return;
+
+    //The average of the points of a convex hull with area lies strictly inside it
+    center /= (float)edge_count;
+    orientation = (area > 0.f) ? 1.f : -1.f;
+
+    angles.resize(edge_count + 1);
+    angles[0] = orientation * atan2f(hull[0].y - center.y, hull[0].x - center.x);
+    float previous = angles[0];
+    float winding = 0.f;
+    for (int i = 1; i <= edge_count; i++)
+    {
+        const vec2& point = hull[i % edge_count];
+        const float angle = orientation * atan2f(point.y - center.y, point.x - center.x);
+
+        float delta = angle - previous;
+        if (delta > PI) delta -= two_pi;
+        if (delta < -PI) delta += two_pi;
+
+        //Points with equal x can make the hull fold back on itself, only tiny rounding steps are allowed
+        if (delta < -0.0001f || delta > PI - 0.001f)
+        {
+            degenerate = true;
+            return;
+        }
+
+        winding += delta;
+        if (i < edge_count)
+            angles[i] = angles[i - 1] + std::max(delta, 0.f);
+        previous = angle;
+    }
+
+    //The hull has to go around the center exactly once
+    if (fabsf(winding - two_pi) > 0.001f)
+    {
+        degenerate = true;
+        return;
+    }
+
+    angles[edge_count] = angles[0] + two_pi;
+    for (int i = 1; i < edge_count; i++)
+        angles[i] = std::min(angles[i], angles[edge_count]);
+}
+
+//Adds the edges whose angular range overlaps [min_angle, max_angle], both within [angles[0], angles[edge_count]]
+void HullQuery::add_edges_in_range(const float min_angle, const float max_angle, std::vector<int>& edges) const
+{
+    //First edge that ends at or after min_angle and last edge that starts at or before max_angle
+    const int first = (int)(std::lower_bound(angles.begin() + 1, angles.end(), min_angle) - (angles.begin() + 1));
+    const int last = (int)(std::upper_bound(angles.begin(), angles.end() - 1, max_angle) - angles.begin()) - 1;
+
+    for (int i = first; i <= last; i++)
+        edges.push_back(i);
+}
+
+void HullQuery::find_candidate_edges(const vec2 position, const float radius, std::vector<int>& edges) const
+{
+    edges.clear();
+
+    const vec2 offset = position - center;
+    const float distance = offset.length();
+
+    //A circle around the center (or a degenerate hull) can touch any edge
+    if (degenerate || distance <= radius)
+    {
+        for (int i = 0; i < edge_count; i++)
+            edges.push_back(i);
+        return;
+    }
+
+    //Half the angle the circle covers as seen from the center, the margin covers rounding
+    const float half_angle = asinf(radius / distance) + 0.001f;
+
+    float angle = orientation * atan2f(offset.y, offset.x);
+    while (angle < angles[0]) angle += two_pi;
+    while (angle >= angles[edge_count]) angle -= two_pi;
+
+    const float min_angle = angle - half_angle;
+    const float max_angle = angle + half_angle;
+
+    //Split the range where it wraps around the first hull point
+    if (min_angle < angles[0])
+    {
+        add_edges_in_range(angles[0], max_angle, edges);
+        add_edges_in_range(min_angle + two_pi, angles[edge_count], edges);
+    }
+    else if (max_angle > angles[edge_count])
+    {
+        add_edges_in_range(angles[0], max_angle - two_pi, edges);
+        add_edges_in_range(min_angle, angles[edge_count], edges);
+    }
+    else
+    {
+        add_edges_in_range(min_angle, max_angle, edges);
+    }
+
+    //The wrapped ranges can overlap for very wide circles
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+}
+} // namespace Tmpl8
@@ -0,0 +1,32 @@
+#pragma once
+
+namespace Tmpl8
+{
+    // -----------------------------------------------------------
+    // Query structure over a convex hull, built once per frame.
+    // The hull edges are sorted by angle around an interior point,
+    // so the edges that can touch a circle are found with a binary
+    // search over the angular extent of that circle.
+    // -----------------------------------------------------------
+    class HullQuery
+    {
+    public:
+        void build(const std::vector<vec2>& hull);
+
+        //Fills edges (ascending) with every hull edge that can intersect the circle, edge i runs from hull[i] to hull[i + 1]
+        void find_candidate_edges(vec2 position, float radius, std::vector<int>& edges) const;
+
+    private:
+        void add_edges_in_range(float min_angle, float max_angle, std::vector<int>& edges) const;
+
+        int edge_count = 0;
+        //Too few points, no area or a hull that folds back, every edge is a candidate
+        bool degenerate = true;
+
+        vec2 center;
+        //+1 for counter clockwise hulls and -1 for clockwise hulls, so the angles always increase
+        float orientation = 1.f;
+        //Angle of hull point i around the center, increasing, angles[edge_count] closes the loop
+        std::vector<float> angles;
+    };
+} // namespace Tmpl8
@@ -0,0 +1,102 @@
+#pragma once
+
+namespace Tmpl8
+{
+    // -----------------------------------------------------------
+    // Parallel top-down merge sort that ping-pongs between the items
+    // and a scratch buffer kept by the sorter, so sorting does not
+    // allocate once the scratch buffer has grown.
+    // The predicate is called as predicate(left, right) and the left
+    // element is taken when it returns true, same as the old
+    // Game::merge_sort, so the output order is the same too.
+    // -----------------------------------------------------------
+    template <typename T>
+    class MergeSorter
+    {
+    public:
+        template <typename Function>
+        void sort(ThreadPool& pool, std::vector<T>& items, const Function& predicate);
+
+    private:
+        //Ranges smaller than this are not worth a task on the thread pool
+        static constexpr int parallel_grain = 512;
+
+        template <typename Function>
+        static void split_merge(ThreadPool& pool, T* source, T* target, int begin, int end, const Function& predicate);
+
+        template <typename Function>
+        static void merge(const T* source, T* target, int begin, int mid, int end, const Function& predicate);
+
+        std::vector<T> scratch;
+    };
+
+    template <typename T>
+    template <typename Function>
+    void MergeSorter<T>::sort(ThreadPool& pool, std::vector<T>& items, const Function& predicate)
+    {
+        scratch.resize(items.size());
+        std::copy(items.begin(), items.end(), scratch.begin());
+
+        split_merge(pool, scratch.data(), items.data(), 0, (int)items.size(), predicate);
+    }
+
+    //Sorts [begin, end) into target, source holds the same elements and is used as scratch space
+    template <typename T>
+    template <typename Function>
+    void MergeSorter<T>::split_merge(ThreadPool& pool, T* source, T* target, const int begin, const int end,
+                                     const Function& predicate)
+    {
+        if (end - begin < 2) return;
+
+        const int mid = (begin + end) / 2;
+
+        //Sort both halves into source (swapping the buffers), then merge them back into target
+        bool sorted = false;
+        if (end - begin >= parallel_grain)
+        {
+            pool.mutex_available_threads.lock();
+            if (pool.threads_available())
+            {
+                TaskLatch right_half;
+                pool.enqueue([&pool, source, target, mid, end, &predicate]
+                {
+                    split_merge(pool, target, source, mid, end, predicate);
+                }, &right_half);
+                pool.mutex_available_threads.unlock();
+
+                split_merge(pool, target, source, begin, mid, predicate);
+                pool.wait(right_half);
+                sorted = true;
+            }
+            else
+            {
+                pool.mutex_available_threads.unlock();
+            }
+        }
+
+        if (!sorted)
+        {
+            split_merge(pool, target, source, begin, mid, predicate);
+            split_merge(pool, target, source, mid, end, predicate);
+        }
+
+        merge(source, target, begin, mid, end, predicate);
+    }
+
+    template <typename T>
+    template <typename Function>
+    void MergeSorter<T>::merge(const T* source, T* target, const int begin, const int mid, const int end,
+                               const Function& predicate)
+    {
+        int left = begin;
+        int right = mid;
+
+        for (int i = begin; i < end; i++)
+        {
+            if (left < mid && (right >= end || predicate(source[left], source[right])))
+                target[i] = source[left++];
+            else
+                target[i] = source[right++];
+        }
+    }
+} // namespace Tmpl8
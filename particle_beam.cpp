@@ -24,14 +24,18 @@ void Particle_beam::tick(vector<Tank>& tanks)
 }
 
 void Particle_beam::draw(Surface* screen) const
+{
+    get_sprite_instance().draw(screen);
+}
+
+SpriteInstance Particle_beam::get_sprite_instance() const
 {
     const vec2 position = rectangle.min;
 
     constexpr int offset_x = 23;
     constexpr int offset_y = 137;
 
-    particle_beam_sprite->set_frame(sprite_frame / 10);
-    particle_beam_sprite->draw(screen, (int)(position.x - offset_x + HEALTHBAR_OFFSET), (int)(position.y - offset_y));
+    return {particle_beam_sprite, sprite_frame / 10, (int)(position.x - offset_x + HEALTHBAR_OFFSET), (int)(position.y - offset_y)};
 }
 
 } // namespace Tmpl8
\ No newline at end of file
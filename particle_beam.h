@@ -9,6 +9,7 @@ class Particle_beam
 
     void tick(vector<Tank>& tanks);
     void draw(Surface* screen) const;
+    SpriteInstance get_sprite_instance() const;
 
     vec2 min_position{};
     vec2 max_position{};
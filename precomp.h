@@ -53,6 +53,7 @@
 
 #include <deque>
 #include <queue>
+#include <unordered_map>
 #include <future>
 #include <mutex>
 #include <thread>
@@ -60,6 +61,7 @@
 
 // Namespaced C headers:
 #include <cassert>
+#include <cstddef>
 #include <cinttypes>
 #include <cmath>
 #include <cstdio>
@@ -82,8 +84,16 @@ using namespace std;
 using namespace Tmpl8;
 
 #include "thread_pool.h"
+#include "merge_sorter.h"
+#include "frame_snapshot.h"
 
 #include "tank.h"
+#include "health_ranking.h"
+#include "tank_store.h"
+#include "spatial_grid.h"
+#include "hull_query.h"
+#include "frame_graph.h"
+#include "route_cache.h"
 #include "terrain.h"
 #include "rocket.h"
 #include "smoke.h"
@@ -21,8 +21,13 @@ void Rocket::tick()
 //Draw the sprite with the facing based on this rockets movement direction
 void Rocket::draw(Surface* screen)
 {
-    rocket_sprite->set_frame(((abs(speed.x) > abs(speed.y)) ? ((speed.x < 0) ? 3 : 0) : ((speed.y < 0) ? 9 : 6)) + (current_frame / 3));
-    rocket_sprite->draw(screen, (int)position.x - 12 + HEALTHBAR_OFFSET, (int)position.y - 12);
+    get_sprite_instance().draw(screen);
+}
+
+SpriteInstance Rocket::get_sprite_instance() const
+{
+    return {rocket_sprite, ((abs(speed.x) > abs(speed.y)) ? ((speed.x < 0) ? 3 : 0) : ((speed.y < 0) ? 9 : 6)) + (current_frame / 3),
+            (int)position.x - 12 + HEALTHBAR_OFFSET, (int)position.y - 12};
 }
 
 //Does the given circle collide with this rockets collision circle?
@@ -11,6 +11,7 @@ class Rocket
 
     void tick();
     void draw(Surface* screen);
+    SpriteInstance get_sprite_instance() const;
 
     auto intersects(vec2 position_other, uint8_t radius_other) const -> bool;
 
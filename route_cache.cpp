@@ -0,0 +1,17 @@
+#include "precomp.h"
+#include "route_cache.h"
+
+namespace Tmpl8
+{
+void RouteCache::clear()
+{
+    for (Shard& shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.routes.clear();
+    }
+
+    hits = 0;
+    misses = 0;
+}
+} // namespace Tmpl8
@@ -0,0 +1,68 @@
+#pragma once
+
+namespace Tmpl8
+{
+    // -----------------------------------------------------------
+    // Routes found so far, keyed by start tile and target tile.
+    // Searches only depend on those two tiles, so tanks that start
+    // in the same tile and head to the same tile share one search.
+    // Safe to use from every thread: the map is split in shards
+    // with their own lock, and the search itself runs unlocked.
+    // -----------------------------------------------------------
+    class RouteCache
+    {
+    public:
+        using Route = std::shared_ptr<const std::vector<vec2>>;
+
+        //Returns the cached route, or runs search() and caches its result
+        template <typename Search>
+        Route find_or_add(int start_tile, int target_tile, const Search& search);
+
+        void clear();
+
+        size_t get_hits() const { return hits; }
+        size_t get_misses() const { return misses; }
+
+    private:
+        struct Shard
+        {
+            std::mutex mutex;
+            std::unordered_map<uint64_t, Route> routes;
+        };
+
+        static uint64_t make_key(const int start_tile, const int target_tile)
+        {
+            return (uint64_t(uint32_t(start_tile)) << 32) | uint32_t(target_tile);
+        }
+
+        static constexpr size_t shard_count = 16;
+        Shard shards[shard_count];
+
+        atomic<size_t> hits = 0;
+        atomic<size_t> misses = 0;
+    };
+
+    template <typename Search>
+    RouteCache::Route RouteCache::find_or_add(const int start_tile, const int target_tile, const Search& search)
+    {
+        const uint64_t key = make_key(start_tile, target_tile);
+        Shard& shard = shards[(uint32_t(start_tile) * 31u + uint32_t(target_tile)) % shard_count];
+
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            const auto found = shard.routes.find(key);
+            if (found != shard.routes.end())
+            {
+                hits++;
+                return found->second;
+            }
+        }
+
+        misses++;
+        Route route = std::make_shared<const std::vector<vec2>>(search());
+
+        //Another thread may have searched the same route in the meantime, both are the same so keep the first
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.routes.emplace(key, std::move(route)).first->second;
+    }
+} // namespace Tmpl8
@@ -11,9 +11,12 @@ void Smoke::tick()
 
 void Smoke::draw(Surface* screen) const
 {
-    smoke_sprite.set_frame(current_frame / 15);
+    get_sprite_instance().draw(screen);
+}
 
-    smoke_sprite.draw(screen, (int)position.x + HEALTHBAR_OFFSET, (int)position.y);
+SpriteInstance Smoke::get_sprite_instance() const
+{
+    return {&smoke_sprite, current_frame / 15, (int)position.x + HEALTHBAR_OFFSET, (int)position.y};
 }
 
 } // namespace Tmpl8
\ No newline at end of file
@@ -9,6 +9,7 @@ class Smoke
 
     void tick();
     void draw(Surface* screen) const;
+    SpriteInstance get_sprite_instance() const;
 
     vec2 position;
 
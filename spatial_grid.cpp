@@ -0,0 +1,122 @@
+#include "precomp.h"
+#include "spatial_grid.h"
+
+namespace Tmpl8
+{
+SpatialGrid::SpatialGrid(const float cell_size, const float world_width, const float world_height)
+    : cell_size(cell_size),
+      inv_cell_size(1.f / cell_size),
+      cells_x((int)ceilf(world_width / cell_size)),
+      cells_y((int)ceilf(world_height / cell_size)),
+      cell_start(cells_x * cells_y + 1, 0)
+{
+}
+
+//Counting sort of all active tanks of the given team into their cells
+void SpatialGrid::build(const TankStore& tanks, const allignments team)
+{
+    //The active ids are in ascending order, tanks destroyed since they were updated are skipped
+    const std::vector<int>& team_ids = tanks.get_active_ids(team);
+
+    std::fill(cell_start.begin(), cell_start.end(), 0);
+    tank_cell.resize(team_ids.size());
+
+    int tank_count = 0;
+    for (size_t i = 0; i < team_ids.size(); i++)
+    {
+        const int id = team_ids[i];
+        if (!tanks.is_active(id))
+        {
+            tank_cell[i] = -1;
+            continue;
+        }
+
+        const int cell = cell_y(tanks.position_y[id]) * cells_x + cell_x(tanks.position_x[id]);
+        tank_cell[i] = cell;
+        cell_start[cell + 1]++;
+        tank_count++;
+    }
+
+//Prefix sum turns the counts into start offsets
+    for (size_t c = 1; c < cell_start.size(); c++)
+        cell_start[c] += cell_start[c - 1];
+
+    //Scatter in index order, cell_start[c] is used as the write cursor and restored afterwards
+    cell_tanks.resize(tank_count);
+    for (size_t i = 0; i < team_ids.size(); i++)
+    {
+        if (tank_cell[i] >= 0)
+            cell_tanks[cell_start[tank_cell[i]]++] = team_ids[i];
+    }
+    for (size_t c = cell_start.size() - 1; c > 0; c--)
+        cell_start[c] = cell_start[c - 1];
+    cell_start[0] = 0;
+}
+
+//Searches rings of cells around the position until no unvisited cell can hold a closer tank
+int SpatialGrid::find_nearest(const TankStore& tanks, const vec2 position, const float slack) const
+{
+    const int center_x = cell_x(position.x);
+    const int center_y = cell_y(position.y);
+    const int max_ring = std::max(cells_x, cells_y);
+
+    float closest_distance = numeric_limits<float>::infinity();
+    int closest_index = -1;
+
+    const auto visit_cell = [&](const int x, const int y)
+    {
+        const int cell = y * cells_x + x;
+        for (int i = cell_start[cell]; i < cell_start[cell + 1]; i++)
+        {
+            const int index = cell_tanks[i];
+            if (!tanks.is_active(index)) continue;
+
+            const float sqr_dist = fabsf((tanks.position(index) - position).dot());
+            if (sqr_dist < closest_distance || (sqr_dist == closest_distance && index < closest_index))
+            {
+                closest_distance = sqr_dist;
+                closest_index = index;
+            }
+        }
+    };
+
+    for (int ring = 0; ring <= max_ring; ring++)
+    {
+        if (ring > 0 && closest_index >= 0)
+        {
+            //Everything in this ring lies outside the square of the rings already searched
+            const float inner_min_x = (float)(center_x - ring + 1) * cell_size;
+            const float inner_max_x = (float)(center_x + ring) * cell_size;
+            const float inner_min_y = (float)(center_y - ring + 1) * cell_size;
+            const float inner_max_y = (float)(center_y + ring) * cell_size;
+
+            const float bound = std::min(std::min(position.x - inner_min_x, inner_max_x - position.x),
+                                         std::min(position.y - inner_min_y, inner_max_y - position.y)) - slack;
+
+            //Strictly greater, a tank at the same distance may still win on index
+            if (bound > 0 && bound * bound > closest_distance) break;
+        }
+
+        const int min_y = std::max(center_y - ring, 0);
+        const int max_y = std::min(center_y + ring, cells_y - 1);
+        const int min_x = std::max(center_x - ring, 0);
+        const int max_x = std::min(center_x + ring, cells_x - 1);
+
+        for (int y = min_y; y <= max_y; y++)
+        {
+            if (y == center_y - ring || y == center_y + ring)
+            {
+                for (int x = min_x; x <= max_x; x++)
+                    visit_cell(x, y);
+            }
+            else
+            {
+                if (center_x - ring >= 0) visit_cell(center_x - ring, y);
+                if (ring > 0 && center_x + ring < cells_x) visit_cell(center_x + ring, y);
+            }
+        }
+    }
+
+    return closest_index;
+}
+} // namespace Tmpl8
@@ -0,0 +1,71 @@
+#pragma once
+
+namespace Tmpl8
+{
+    // -----------------------------------------------------------
+    // Uniform grid that buckets active tank indices per cell.
+    // Rebuilt every frame with a counting sort, so within a cell
+    // the indices are always in ascending order and building
+    // does not allocate once the buffers have grown.
+    // -----------------------------------------------------------
+    class SpatialGrid
+    {
+    public:
+        SpatialGrid(float cell_size, float world_width, float world_height);
+
+        void build(const TankStore& tanks, allignments team);
+
+        //Calls function(index) for every tank in the cells overlapping the box (may include tanks just outside)
+        template <typename Function>
+        void for_each_in_box(vec2 min, vec2 max, Function function) const;
+
+        //Index of the active tank closest to position (lowest index on ties), -1 if there is none
+        //slack is the maximum distance any tank may have moved since the grid was built
+        int find_nearest(const TankStore& tanks, vec2 position, float slack) const;
+
+    private:
+        int cell_x(float x) const;
+        int cell_y(float y) const;
+
+        float cell_size;
+        float inv_cell_size;
+        int cells_x;
+        int cells_y;
+
+        //cell_start[c] .. cell_start[c + 1] is the range of cell c in cell_tanks
+        std::vector<int> cell_start;
+        std::vector<int> cell_tanks;
+        std::vector<int> tank_cell; //Per entry of the team active ids
+    };
+
+    inline int SpatialGrid::cell_x(const float x) const
+    {
+        //Tanks outside the battlefield end up in the border cells
+        return clamp((int)(x * inv_cell_size), 0, cells_x - 1);
+    }
+
+    inline int SpatialGrid::cell_y(const float y) const
+    {
+        return clamp((int)(y * inv_cell_size), 0, cells_y - 1);
+    }
+
+    template <typename Function>
+    void SpatialGrid::for_each_in_box(const vec2 min, const vec2 max, Function function) const
+    {
+        const int min_x = cell_x(min.x);
+        const int max_x = cell_x(max.x);
+        const int max_y = cell_y(max.y);
+
+        for (int y = cell_y(min.y); y <= max_y; y++)
+        {
+            for (int x = min_x; x <= max_x; x++)
+            {
+                const int cell = y * cells_x + x;
+                for (int i = cell_start[cell]; i < cell_start[cell + 1]; i++)
+                {
+                    function(cell_tanks[i]);
+                }
+            }
+        }
+    }
+} // namespace Tmpl8
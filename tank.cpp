@@ -5,6 +5,7 @@
 namespace Tmpl8
 {
 Tank::Tank(
+    TankStore& store,
     float pos_x,
     float pos_y,
     allignments allignment,
@@ -14,27 +15,41 @@ Tank::Tank(
     float tar_y,
     int health,
     float max_speed)
-    : position(pos_x, pos_y),
-      allignment(allignment),
+    : allignment(allignment),
       target(tar_x, tar_y),
-      health(health),
       max_speed(max_speed),
-      force(0, 0),
       reload_time(1),
       reloaded(false),
       speed(0),
-      active(true),
       current_frame(0),
       tank_sprite(tank_sprite),
-      smoke_sprite(smoke_sprite)
+      smoke_sprite(smoke_sprite),
+      store(&store),
+      id(store.add(vec2(pos_x, pos_y), allignment, health))
 {
 }
 
 Tank::~Tank()
 = default;
 
+vec2 Tank::get_position() const
+{
+    return store->position(id);
+}
+
+int Tank::get_health() const
+{
+    return store->health[id];
+}
+
+bool Tank::is_active() const
+{
+    return store->is_active(id);
+}
+
 void Tank::tick(Terrain& terrain)
 {
+    vec2 position = store->position(id);
     vec2 direction = vec2(0, 0);
 
     if (target != position)
@@ -43,8 +58,9 @@ void Tank::tick(Terrain& terrain)
     }
 
     //Update using accumulated force
-    speed = direction + force;
+    speed = direction + store->force(id);
     position += speed * max_speed * 0.5f;
+    store->set_position(id, position);
 
     //Update reload time
     if (--reload_time <= 0.0f)
@@ -52,7 +68,7 @@ void Tank::tick(Terrain& terrain)
         reloaded = true;
     }
 
-    force = vec2(0.f, 0.f);
+    store->clear_force(id);
 
     if (++current_frame > 8) current_frame = 0;
 
@@ -77,10 +93,15 @@ void Tank::set_route(const std::vector<vec2>& route)
     }
     else
     {
-        target = position;
+        target = get_position();
     }
 }
 
+vec2 Tank::get_destination() const
+{
+    return current_route.empty() ? target : current_route.back();
+}
+
 //Start reloading timer
 void Tank::reload_rocket()
 {
@@ -90,40 +111,40 @@ void Tank::reload_rocket()
 
 void Tank::deactivate()
 {
-    active = false;
+    store->deactivate(id);
 }
 
 //Remove health
 bool Tank::hit(const int hit_value)
 {
-    health -= hit_value;
-
-    if (health <= 0)
-    {
-        this->deactivate();
-        return true;
-    }
-
-    return false;
+    return store->hit(id, hit_value);
 }
 
 //Draw the sprite with the facing based on this tanks movement direction
 void Tank::draw(Surface* screen) const
 {
+    get_sprite_instance().draw(screen);
+}
+
+SpriteInstance Tank::get_sprite_instance() const
+{
+    const vec2 position = get_position();
     const vec2 direction = (target - position).normalized();
-    tank_sprite->set_frame(((abs(direction.x) > abs(direction.y)) ? ((direction.x < 0) ? 3 : 0) : ((direction.y < 0) ? 9 : 6)) + (current_frame / 3));
-    tank_sprite->draw(screen, (int)position.x - 7 + HEALTHBAR_OFFSET, (int)position.y - 9);
+    return {tank_sprite, ((abs(direction.x) > abs(direction.y)) ? ((direction.x < 0) ? 3 : 0) : ((direction.y < 0) ? 9 : 6)) + (current_frame / 3),
+            (int)position.x - 7 + HEALTHBAR_OFFSET, (int)position.y - 9};
 }
 
 int Tank::compare_health(const Tank& other) const
 {
-    return ((health == other.health) ? 0 : ((health > other.health) ? 1 : -1));
+    const int health = get_health();
+    const int other_health = other.get_health();
+    return ((health == other_health) ? 0 : ((health > other_health) ? 1 : -1));
 }
 
 //Add some force in a given direction
 void Tank::push(const vec2 direction, const float magnitude)
 {
-    force += direction * magnitude;
+    store->push(id, direction, magnitude);
 }
 
-} // namespace Tmpl8
\ No newline at end of file
+} // namespace Tmpl8
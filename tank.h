@@ -3,6 +3,7 @@
 namespace Tmpl8
 {
     class Terrain; //forward declare
+    class TankStore;
 
     enum allignments
     {
@@ -10,51 +11,56 @@ namespace Tmpl8
         RED
     };
 
+    //Handle into the TankStore (hot state) plus the cold per tank data
     class Tank
     {
     public:
-        Tank(float pos_x, float pos_y, allignments allignment, Sprite* tank_sprite, Sprite* smoke_sprite, float tar_x,
-             float tar_y, int health, float max_speed);
+        Tank(TankStore& store, float pos_x, float pos_y, allignments allignment, Sprite* tank_sprite,
+             Sprite* smoke_sprite, float tar_x, float tar_y, int health, float max_speed);
 
         ~Tank();
 
         void tick(Terrain& terrain);
 
-        vec2 get_position() const { return position; };
+        int get_id() const { return id; }
+        vec2 get_position() const;
+        int get_health() const;
+        bool is_active() const;
         bool rocket_reloaded() const { return reloaded; };
 
         void set_route(const std::vector<vec2>& route);
+        //End of the current route, target only holds the next tile of it
+        vec2 get_destination() const;
         void reload_rocket();
 
         void deactivate();
         bool hit(int hit_value);
 
         void draw(Surface* screen) const;
+        SpriteInstance get_sprite_instance() const;
 
         int compare_health(const Tank& other) const;
 
         void push(vec2 direction, float magnitude);
 
-        vec2 position;
         vec2 speed;
         vec2 target;
 
         vector<vec2> current_route;
 
-        int health;
-
-        vec2 force;
-
         float max_speed;
         float reload_time;
 
         bool reloaded;
-        bool active;
 
         allignments allignment;
 
         int current_frame;
         Sprite* tank_sprite;
         Sprite* smoke_sprite;
+
+    private:
+        TankStore* store;
+        int id;
     };
 } // namespace Tmpl8
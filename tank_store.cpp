@@ -0,0 +1,97 @@
+#include "precomp.h"
+#include "tank_store.h"
+
+namespace Tmpl8
+{
+void TankStore::reserve(const size_t count)
+{
+    position_x.reserve(count);
+    position_y.reserve(count);
+    force_x.reserve(count);
+    force_y.reserve(count);
+    health.reserve(count);
+    team.reserve(count);
+    ranking_slot.reserve(count);
+    active.reserve((count + 63) / 64);
+    active_ids.reserve(count);
+    team_active_ids[0].reserve(count);
+    team_active_ids[1].reserve(count);
+}
+
+//Adds an active tank and returns its id
+int TankStore::add(const vec2 position, const allignments team, const int health)
+{
+    const int id = size();
+
+    position_x.push_back(position.x);
+    position_y.push_back(position.y);
+    force_x.push_back(0.f);
+    force_y.push_back(0.f);
+    this->health.push_back(health);
+    this->team.push_back(team);
+    ranking_slot.push_back(health_rankings[team].add(id, health));
+
+    if ((id & 63) == 0) active.push_back(0);
+    active[id >> 6] |= uint64_t(1) << (id & 63);
+    active_ids.push_back(id);
+    team_active_ids[team].push_back(id);
+
+    return id;
+}
+
+//Add some force in a given direction
+void TankStore::push(const int id, const vec2 direction, const float magnitude)
+{
+    force_x[id] += direction.x * magnitude;
+    force_y[id] += direction.y * magnitude;
+}
+
+void TankStore::deactivate(const int id)
+{
+    if (!is_active(id)) return;
+
+    active[id >> 6] &= ~(uint64_t(1) << (id & 63));
+    health_rankings[team[id]].remove(ranking_slot[id]);
+    active_ids_dirty = true;
+}
+
+//Walks the set bits only, so the cost is one word per 64 tanks plus one step per living tank
+void TankStore::update_active_ids()
+{
+    if (!active_ids_dirty) return;
+
+    active_ids.clear();
+    team_active_ids[0].clear();
+    team_active_ids[1].clear();
+
+    for (size_t word = 0; word < active.size(); word++)
+    {
+        uint64_t bits = active[word];
+        while (bits)
+        {
+            const int id = (int)(word * 64) + lowest_bit(bits);
+            bits &= bits - 1;
+
+            active_ids.push_back(id);
+            team_active_ids[team[id]].push_back(id);
+        }
+    }
+
+    active_ids_dirty = false;
+}
+
+//Remove health, returns true if the tank got destroyed
+bool TankStore::hit(const int id, const int hit_value)
+{
+    health[id] -= hit_value;
+
+    if (health[id] <= 0)
+    {
+        deactivate(id);
+        return true;
+    }
+
+    health_rankings[team[id]].update(ranking_slot[id], health[id]);
+    return false;
+}
+} // namespace Tmpl8
@@ -0,0 +1,72 @@
+#pragma once
+
+namespace Tmpl8
+{
+    // -----------------------------------------------------------
+    // Structure of arrays storage for the hot tank state.
+    // The per-frame stages (collision, targeting, rocket hits,
+    // convex hull, particle beams) stream over these dense arrays,
+    // the Tank objects only keep the cold data (route, sprites,
+    // animation) and a handle into this store.
+    // A tank id is its index in the store and in Game::tanks.
+    // -----------------------------------------------------------
+    class TankStore
+    {
+    public:
+        void reserve(size_t count);
+        int add(vec2 position, allignments team, int health);
+        int size() const { return (int)position_x.size(); }
+
+        vec2 position(const int id) const { return {position_x[id], position_y[id]}; }
+        void set_position(const int id, const vec2 position)
+        {
+            position_x[id] = position.x;
+            position_y[id] = position.y;
+        }
+
+        vec2 force(const int id) const { return {force_x[id], force_y[id]}; }
+        void push(int id, vec2 direction, float magnitude);
+        void clear_force(const int id)
+        {
+            force_x[id] = 0.f;
+            force_y[id] = 0.f;
+        }
+
+        bool is_active(const int id) const { return (active[id >> 6] >> (id & 63)) & 1; }
+        void deactivate(int id);
+
+        //Active tank ids in ascending order, all teams or one team
+        //Tanks destroyed since the last update_active_ids are still listed, check is_active after hits
+        const std::vector<int>& get_active_ids() const { return active_ids; }
+        const std::vector<int>& get_active_ids(const allignments team) const { return team_active_ids[team]; }
+        void update_active_ids();
+
+        bool hit(int id, int hit_value);
+
+        //Ids of the (at most) count active tanks of the team with the lowest health, lowest first
+        const std::vector<int>& lowest_health(const allignments team, const int count)
+        {
+            return health_rankings[team].lowest(count);
+        }
+
+        std::vector<float> position_x;
+        std::vector<float> position_y;
+        std::vector<float> force_x;
+        std::vector<float> force_y;
+        std::vector<int> health;
+        std::vector<allignments> team;
+
+        //One bit per tank, 64 tanks per word
+        std::vector<uint64_t> active;
+
+    private:
+        //Health index per team (indexed by allignment), updated in hit and deactivate
+        HealthRanking health_rankings[2];
+        std::vector<int> ranking_slot;
+
+        //Dense id lists rebuilt from the active bits, only when a tank got destroyed in between
+        std::vector<int> active_ids;
+        std::vector<int> team_active_ids[2];
+        bool active_ids_dirty = false;
+    };
+} // namespace Tmpl8
@@ -41,6 +41,18 @@ typedef unsigned int uint;
 #define unlikely(expr) __builtin_expect((expr), false)
 #endif
 
+// index of the lowest set bit, x must not be 0
+#if defined(_MSC_VER) && !defined(__INTEL_COMPILER)
+inline int lowest_bit(uint64 x)
+{
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return (int)index;
+}
+#else
+inline int lowest_bit(uint64 x) { return __builtin_ctzll(x); }
+#endif
+
 // deterministic rng
 static uint seed = 0x12345678;
 inline uint random_uint()
@@ -5,16 +5,74 @@ namespace fs = std::filesystem;
 namespace Tmpl8
 {
 
-    // Define the pair type for readability
-    typedef std::pair<float, std::vector<TerrainTile*>> FloatVectorPair;
-    //creating struct for comparison in prioritized queue. this is where the heuristic is defined. min heap sorting
-    struct CompareDist {
-        bool operator()(const FloatVectorPair& left, const FloatVectorPair& right) const {
-            return left.first > right.first;
+    //Open set entry, ordered on f and then on h so the node closest to the target goes first on ties
+    struct OpenNode
+    {
+        int f;
+        int h;
+        int index;
+    };
+    struct CompareOpenNode {
+        bool operator()(const OpenNode& left, const OpenNode& right) const {
+            return left.f > right.f || (left.f == right.f && left.h > right.h);
+        }
+    };
 
+    //Per thread A* state indexed by tile, a tile only counts as seen if its generation matches the current search
+    //so nothing has to be cleared between searches and the buffers are only allocated once per thread
+    struct SearchState
+    {
+        std::vector<uint32_t> generation;
+        std::vector<int> cost;
+        std::vector<int> parent;
+        std::vector<OpenNode> open;
+        std::vector<int> route;
+        uint32_t current_generation = 0;
+
+        void start(const size_t tile_count)
+        {
+            if (generation.size() != tile_count || ++current_generation == 0)
+            {
+                generation.assign(tile_count, 0);
+                cost.resize(tile_count);
+                parent.resize(tile_count);
+                current_generation = 1;
+            }
+            open.clear();
+            route.clear();
         }
     };
-    
+    static thread_local SearchState search_state;
+    //Same state for the search over the cluster graph, indexed by node instead of tile
+    static thread_local SearchState cluster_search_state;
+
+    static constexpr int cluster_size = 8;
+    //Border openings this wide or wider get a node at both ends instead of one in the middle
+    static constexpr int wide_entrance = 2;
+
+    static constexpr int cluster_tiles = cluster_size * cluster_size;
+
+    //Position of the tile inside its cluster, clusters start at multiples of cluster_size
+    static int cluster_local(const int tile, const int width)
+    {
+        return (tile / width % cluster_size) * cluster_size + tile % width % cluster_size;
+    }
+
+    //Breadth-first search state for one cluster, indexed by the position of the tile inside the cluster
+    struct ClusterSearch
+    {
+        int width = 0;
+        std::array<int, cluster_tiles> distance;
+        std::array<int, cluster_tiles> parent;
+        std::array<int, cluster_tiles> queue;
+
+        //-1 for tiles that can't be reached without leaving the cluster
+        int get_distance(const int tile) const { return distance[cluster_local(tile, width)]; }
+        int get_parent(const int tile) const { return parent[cluster_local(tile, width)]; }
+    };
+    static thread_local ClusterSearch start_cluster_search;
+    static thread_local ClusterSearch goal_cluster_search;
+
     Terrain::Terrain()
     {
         //Load in terrain sprites
@@ -97,6 +155,8 @@ namespace Tmpl8
                 if (is_accessible(y - 1, x)) { tiles[y][x].exits.push_back(&tiles[y - 1][x]); }
             }
         }
+
+        build_cluster_graph();
     }
 
     void Terrain::update()
@@ -143,8 +203,8 @@ namespace Tmpl8
     vector<vec2> Terrain::get_route(const Tank& tank, const vec2& target)
     {
         //Find start and target tile
-        const size_t pos_x = tank.position.x / sprite_size;
-        const size_t pos_y = tank.position.y / sprite_size;
+        const size_t pos_x = tank.get_position().x / sprite_size;
+        const size_t pos_y = tank.get_position().y / sprite_size;
 
         const size_t target_x = target.x / sprite_size;
         const size_t target_y = target.y / sprite_size;
@@ -234,80 +294,611 @@ namespace Tmpl8
     }
 
 
-    //for calculating the distance between 2 tiles
+    //Manhattan distance between 2 tiles, the exact route length on open terrain
     float Terrain::get_distance_to_target(const TerrainTile* current_tile, const TerrainTile* destination ) const
     {
-        return fabs((((float)destination->position_x) - ((float)current_tile->position_x)) + (((float)destination->position_y) - ((float)current_tile->position_y)));
+        return fabs(((float)destination->position_x) - ((float)current_tile->position_x)) + fabs(((float)destination->position_y) - ((float)current_tile->position_y));
     }
 
     //Use A* search to find shortest route to the destination
-    vector<vec2> Terrain::a_star(const Tank& tank, const vec2& target)
+    vector<vec2> Terrain::a_star(const Tank& tank, const vec2& target) const
     {
         //Find start and target tile
-        const size_t pos_x = tank.position.x / sprite_size;
-        const size_t pos_y = tank.position.y / sprite_size;
+        const size_t pos_x = tank.get_position().x / sprite_size;
+        const size_t pos_y = tank.get_position().y / sprite_size;
 
         const size_t target_x = target.x / sprite_size;
         const size_t target_y = target.y / sprite_size;
 
-        //Init queue, using a priority que to implement A* heuristics. the heuristic is defined in CompareDist struct on the top of the file
-        priority_queue<FloatVectorPair, vector<FloatVectorPair>, CompareDist> queue;
-        //setting distance of starter tile
-        //adding start tile
-        queue.push({0, {&tiles.at(pos_y).at(pos_x)}});
-        std::vector<TerrainTile*> visited;
+        const TerrainTile* destination = &tiles.at(target_y).at(target_x);
+        const int start = tile_index(&tiles.at(pos_y).at(pos_x));
+        const int goal = tile_index(destination);
+
+        SearchState& state = search_state;
+        state.start(terrain_width * terrain_height);
 
+        state.generation[start] = state.current_generation;
+        state.cost[start] = 0;
+        state.parent[start] = -1;
+        const int start_h = (int)get_distance_to_target(&tiles[pos_y][pos_x], destination);
+        state.open.push_back({start_h, start_h, start});
+
+        //The open set is a binary heap of tile indices, the route is only built once the target is reached
         bool route_found = false;
-        vector<TerrainTile*> current_route;
-        while (!queue.empty() && !route_found)
+        while (!state.open.empty())
         {
-            current_route = queue.top().second;
-            queue.pop();
-            const TerrainTile* current_tile = current_route.back();
-           
-            //Check all exits, if target then done, else if unvisited push a new partial route
-            for (TerrainTile* exit : current_tile->exits)
+            std::pop_heap(state.open.begin(), state.open.end(), CompareOpenNode());
+            const OpenNode node = state.open.back();
+            state.open.pop_back();
+
+            //Tiles are pushed again when a shorter way is found, skip the outdated entries
+            if (node.f - node.h > state.cost[node.index]) continue;
+
+            if (node.index == goal)
             {
+                route_found = true;
+                break;
+            }
 
-                if (exit->position_x == target_x && exit->position_y == target_y)
+            const TerrainTile& current_tile = tiles[node.index / terrain_width][node.index % terrain_width];
+            const int exit_cost = state.cost[node.index] + 1;
+
+            for (const TerrainTile* exit : current_tile.exits)
+            {
+                const int exit_index = tile_index(exit);
+                if (state.generation[exit_index] == state.current_generation && state.cost[exit_index] <= exit_cost) continue;
+
+                state.generation[exit_index] = state.current_generation;
+                state.cost[exit_index] = exit_cost;
+                state.parent[exit_index] = node.index;
+
+                const int h = (int)get_distance_to_target(exit, destination);
+                state.open.push_back({exit_cost + h, h, exit_index});
+                std::push_heap(state.open.begin(), state.open.end(), CompareOpenNode());
+            }
+        }
+
+        if (!route_found)
+        {
+            return std::vector<vec2>();
+        }
+
+        //Walk the parents back from the target and convert to vec2 to prevent dangling pointers
+        for (int index = goal; index >= 0; index = state.parent[index])
+            state.route.push_back(index);
+
+        std::vector<vec2> route;
+        route.reserve(state.route.size());
+        for (auto index = state.route.rbegin(); index != state.route.rend(); ++index)
+        {
+            route.push_back(vec2((float)(*index % terrain_width) * sprite_size, (float)(*index / terrain_width) * sprite_size));
+        }
+
+        return route;
+    }
+
+    // -----------------------------------------------------------
+    // Jump point search for the 4-connected grid
+    // Shortest routes are only followed in one canonical form: vertical runs that may turn sideways
+    // at any tile, and horizontal runs that only turn where an obstacle forces it.
+    // Runs are jumped over without pushing their tiles, only their ends (jump points) enter the open set.
+    // -----------------------------------------------------------
+    vector<vec2> Terrain::jump_point_search(const Tank& tank, const vec2& target) const
+    {
+        const int width = (int)terrain_width;
+        const int start = get_tile_index(tank.get_position());
+        const int goal = get_tile_index(target);
+        const int goal_x = goal % width;
+        const int goal_y = goal / width;
+
+        SearchState& state = search_state;
+        state.start(terrain_width * terrain_height);
+
+        const auto heuristic = [width, goal_x, goal_y](const int index)
+        {
+            return abs(goal_x - index % width) + abs(goal_y - index / width);
+        };
+
+        //Jump points are pushed with the length of the straight run that led to them
+        const auto add_jump_point = [&](const int index, const int parent)
+        {
+            if (index < 0) return;
+
+            const int cost = state.cost[parent] + abs(index % width - parent % width) +
+                abs(index / width - parent / width);
+            if (state.generation[index] == state.current_generation && state.cost[index] <= cost) return;
+
+            state.generation[index] = state.current_generation;
+            state.cost[index] = cost;
+            state.parent[index] = parent;
+
+            const int h = heuristic(index);
+            state.open.push_back({cost + h, h, index});
+            std::push_heap(state.open.begin(), state.open.end(), CompareOpenNode());
+        };
+
+        state.generation[start] = state.current_generation;
+        state.cost[start] = 0;
+        state.parent[start] = -1;
+        state.open.push_back({heuristic(start), heuristic(start), start});
+
+        bool route_found = false;
+        while (!state.open.empty())
+        {
+            std::pop_heap(state.open.begin(), state.open.end(), CompareOpenNode());
+            const OpenNode node = state.open.back();
+            state.open.pop_back();
+
+            if (node.f - node.h > state.cost[node.index]) continue;
+
+            if (node.index == goal)
+            {
+                route_found = true;
+                break;
+            }
+
+            const int x = node.index % width;
+            const int y = node.index / width;
+            const int parent = state.parent[node.index];
+
+            if (parent < 0)
+            {
+                //The start tile goes every way
+                add_jump_point(jump_horizontal(x, y, 1, goal), node.index);
+                add_jump_point(jump_horizontal(x, y, -1, goal), node.index);
+                add_jump_point(jump_vertical(x, y, 1, goal), node.index);
+                add_jump_point(jump_vertical(x, y, -1, goal), node.index);
+            }
+            else if (parent / width == y)
+            {
+                //Arrived horizontally, keep going and turn only towards the forced neighbours
+                const int direction = (x > parent % width) ? 1 : -1;
+                add_jump_point(jump_horizontal(x, y, direction, goal), node.index);
+                for (int turn = -1; turn <= 1; turn += 2)
                 {
-                    current_route.push_back(exit);
-                    route_found = true;
-                    break;
+                    if (is_accessible(y + turn, x) && !is_accessible(y + turn, x - direction))
+                        add_jump_point(jump_vertical(x, y, turn, goal), node.index);
+                }
+            }
+            else
+            {
+                //Arrived vertically, keep going or turn either way
+                const int direction = (y > parent / width) ? 1 : -1;
+                add_jump_point(jump_vertical(x, y, direction, goal), node.index);
+                add_jump_point(jump_horizontal(x, y, 1, goal), node.index);
+                add_jump_point(jump_horizontal(x, y, -1, goal), node.index);
+            }
+        }
+
+        if (!route_found)
+        {
+            return std::vector<vec2>();
+        }
+
+        //Collect the jump points back from the target, the tiles in between lie on straight runs
+        for (int index = goal; index >= 0; index = state.parent[index])
+            state.route.push_back(index);
+
+        std::vector<vec2> route;
+        route.reserve(state.cost[goal] + 1);
+        route.push_back(vec2((float)(start % width) * sprite_size, (float)(start / width) * sprite_size));
+        for (size_t i = state.route.size() - 1; i > 0; i--)
+        {
+            int x = state.route[i] % width;
+            int y = state.route[i] / width;
+            const int next_x = state.route[i - 1] % width;
+            const int next_y = state.route[i - 1] / width;
+
+            while (x != next_x || y != next_y)
+            {
+                x += (next_x > x) - (next_x < x);
+                y += (next_y > y) - (next_y < y);
+                route.push_back(vec2((float)x * sprite_size, (float)y * sprite_size));
+            }
+        }
+
+        return route;
+    }
+
+    //Index of the next jump point along the row, -1 if the run ends against an obstacle
+    int Terrain::jump_horizontal(int x, const int y, const int direction, const int goal) const
+    {
+        while (true)
+        {
+            x += direction;
+            if (!is_accessible(y, x)) return -1;
+
+            const int index = y * (int)terrain_width + x;
+            if (index == goal) return index;
+
+            //A tile above or below that opens up behind an obstacle can only be reached by turning here
+            if ((is_accessible(y + 1, x) && !is_accessible(y + 1, x - direction)) ||
+                (is_accessible(y - 1, x) && !is_accessible(y - 1, x - direction)))
+                return index;
+        }
+    }
+
+    //Index of the next jump point along the column, a tile is one if a horizontal run from it finds one
+    int Terrain::jump_vertical(const int x, int y, const int direction, const int goal) const
+    {
+        while (true)
+        {
+            y += direction;
+            if (!is_accessible(y, x)) return -1;
+
+            const int index = y * (int)terrain_width + x;
+            if (index == goal) return index;
+
+            if (jump_horizontal(x, y, 1, goal) >= 0 || jump_horizontal(x, y, -1, goal) >= 0)
+                return index;
+        }
+    }
+
+    // -----------------------------------------------------------
+    // Hierarchical search (HPA*)
+    // Start and target are linked to the nodes of their own cluster, the route is searched over
+    // the cluster graph and only the legs it uses are refined into tiles, one cluster at a time.
+    // Openings get one or two nodes, so routes can be a few tiles longer than the ones from a_star.
+    // -----------------------------------------------------------
+    vector<vec2> Terrain::hierarchical_search(const Tank& tank, const vec2& target) const
+    {
+        const int width = (int)terrain_width;
+        const int start = get_tile_index(tank.get_position());
+        const int goal = get_tile_index(target);
+        const int goal_x = goal % width;
+        const int goal_y = goal / width;
+
+        const auto to_position = [width](const int tile)
+        {
+            return vec2((float)(tile % width) * sprite_size, (float)(tile / width) * sprite_size);
+        };
+
+        if (start == goal) return {to_position(start)};
+        if (!is_accessible(goal_y, goal_x)) return std::vector<vec2>();
+
+        //A tank on an inaccessible tile can only leave it, its exits don't have to be in its own cluster
+        const TerrainTile& start_tile = tiles[start / width][start % width];
+        if (!is_accessible(start / width, start % width) &&
+            std::any_of(start_tile.exits.begin(), start_tile.exits.end(), [&](const TerrainTile* exit) { return get_cluster(tile_index(exit)) != get_cluster(start); }))
+        {
+            return a_star(tank, target);
+        }
+
+        //Moves between accessible tiles go both ways, so searching from the target gives the distances to it
+        ClusterSearch& start_search = start_cluster_search;
+        ClusterSearch& goal_search = goal_cluster_search;
+        search_cluster(start, start_search);
+        search_cluster(goal, goal_search);
+
+        //Start and target join the graph for this search only, as the two nodes after the graph nodes
+        const int node_count = (int)cluster_graph.node_tiles.size();
+        const int start_node = node_count;
+        const int goal_node = node_count + 1;
+        const int start_cluster = get_cluster(start);
+        const int goal_cluster = get_cluster(goal);
+
+        const auto node_tile = [&](const int node)
+        {
+            return (node == start_node) ? start : (node == goal_node) ? goal : cluster_graph.node_tiles[node];
+        };
+
+        SearchState& state = cluster_search_state;
+        state.start(node_count + 2);
+
+        const auto add_node = [&](const int node, const int parent, const int cost)
+        {
+            if (state.generation[node] == state.current_generation && state.cost[node] <= cost) return;
+
+            state.generation[node] = state.current_generation;
+            state.cost[node] = cost;
+            state.parent[node] = parent;
+
+            const int tile = node_tile(node);
+            const int h = abs(goal_x - tile % width) + abs(goal_y - tile / width);
+            state.open.push_back({cost + h, h, node});
+            std::push_heap(state.open.begin(), state.open.end(), CompareOpenNode());
+        };
+
+        state.generation[start_node] = state.current_generation;
+        state.cost[start_node] = 0;
+        state.parent[start_node] = -1;
+        state.open.push_back({0, 0, start_node});
+
+        bool route_found = false;
+        while (!state.open.empty())
+        {
+            std::pop_heap(state.open.begin(), state.open.end(), CompareOpenNode());
+            const OpenNode node = state.open.back();
+            state.open.pop_back();
+
+            if (node.f - node.h > state.cost[node.index]) continue;
+
+            if (node.index == goal_node)
+            {
+                route_found = true;
+                break;
+            }
+
+            const int cost = state.cost[node.index];
+            if (node.index == start_node)
+            {
+                for (const int other : cluster_graph.cluster_nodes[start_cluster])
+                {
+                    const int distance = start_search.get_distance(cluster_graph.node_tiles[other]);
+                    if (distance >= 0) add_node(other, start_node, distance);
+                }
+                if (start_cluster == goal_cluster && start_search.get_distance(goal) >= 0)
+                    add_node(goal_node, start_node, start_search.get_distance(goal));
+                continue;
+            }
+
+            for (const ClusterGraph::Edge& edge : cluster_graph.edges[node.index])
+                add_node(edge.node, node.index, cost + edge.cost);
+
+            const int tile = cluster_graph.node_tiles[node.index];
+            if (get_cluster(tile) == goal_cluster && goal_search.get_distance(tile) >= 0)
+                add_node(goal_node, node.index, cost + goal_search.get_distance(tile));
+        }
+
+        if (!route_found)
+        {
+            return std::vector<vec2>();
+        }
+
+        for (int node = goal_node; node >= 0; node = state.parent[node])
+            state.route.push_back(node);
+
+        //Legs between clusters are a single step, legs inside a cluster follow the parents of a search from their first tile,
+        //except the last leg, the search from the target leads to it
+        std::vector<vec2> route;
+        route.reserve(state.cost[goal_node] + 1);
+        route.push_back(to_position(start));
+        for (size_t i = state.route.size() - 1; i > 0; i--)
+        {
+            const int from_node = state.route[i];
+            const int from = node_tile(from_node);
+            const int to = node_tile(state.route[i - 1]);
+            if (get_cluster(from) != get_cluster(to))
+            {
+                route.push_back(to_position(to));
+                continue;
+            }
+
+            if (to == goal && from_node != start_node)
+            {
+                for (int tile = goal_search.get_parent(from); tile >= 0; tile = goal_search.get_parent(tile))
+                    route.push_back(to_position(tile));
+                continue;
+            }
+
+            const size_t leg_begin = route.size();
+            for (int tile = to; tile != from;)
+            {
+                route.push_back(to_position(tile));
+                tile = (from_node == start_node) ? start_search.get_parent(tile)
+                                                 : cluster_graph.leg_parents[from_node * cluster_tiles + cluster_local(tile, width)];
+            }
+            std::reverse(route.begin() + leg_begin, route.end());
+        }
+
+        return route;
+    }
+
+    // -----------------------------------------------------------
+    // Builds the cluster graph when the terrain is loaded
+    // Every opening in the border between two neighbouring clusters gets a node on both sides,
+    // then a search from every node inside its cluster gives the distances to the other nodes there.
+    // The parents of that search are kept, a route only turns them into tiles for the legs it takes.
+    // -----------------------------------------------------------
+    void Terrain::build_cluster_graph()
+    {
+        const int width = (int)terrain_width;
+        const int height = (int)terrain_height;
+        const int cluster_count = ((width + cluster_size - 1) / cluster_size) * ((height + cluster_size - 1) / cluster_size);
+
+        cluster_graph = ClusterGraph();
+        cluster_graph.cluster_nodes.resize(cluster_count);
+        cluster_graph.tile_nodes.assign(width * height, -1);
+
+        const auto is_open = [this, width](const int tile) { return is_accessible(tile / width, tile % width); };
+
+        const auto add_transition = [this](const int tile, const int across)
+        {
+            const int node = add_cluster_node(tile);
+            const int other = add_cluster_node(tile + across);
+            cluster_graph.edges[node].push_back({other, 1});
+            cluster_graph.edges[other].push_back({node, 1});
+        };
+
+        //Walks length tiles along a border, across is the step to the tile on the other side
+        const auto add_openings = [&](const int first, const int length, const int along, const int across)
+        {
+            int opening_begin = -1;
+            for (int i = 0; i <= length; i++)
+            {
+                const int tile = first + i * along;
+                const bool open = i < length && is_open(tile) && is_open(tile + across);
+                if (open && opening_begin < 0) opening_begin = i;
+                if (open || opening_begin < 0) continue;
+
+                const int opening_length = i - opening_begin;
+                if (opening_length < wide_entrance)
+                {
+                    add_transition(first + (opening_begin + opening_length / 2) * along, across);
                 }
-                else if (!exit->visited)
+                else
                 {
-                    exit->visited = true;
-                    visited.push_back(exit);
-                    float cost = get_distance_to_target(exit, &tiles.at(target_y).at(target_x));
-                    current_route.push_back(exit);
-                    queue.push({cost, current_route });
-                    current_route.pop_back();
+                    add_transition(first + opening_begin * along, across);
+                    add_transition(first + (i - 1) * along, across);
+                }
+                opening_begin = -1;
+            }
+        };
+
+        for (int cluster_y = 0; cluster_y < height; cluster_y += cluster_size)
+        {
+            for (int cluster_x = 0; cluster_x < width; cluster_x += cluster_size)
+            {
+                //Border with the cluster to the right
+                if (cluster_x + cluster_size < width)
+                    add_openings(cluster_y * width + cluster_x + cluster_size - 1, std::min(cluster_size, height - cluster_y), width, 1);
+                //Border with the cluster below
+                if (cluster_y + cluster_size < height)
+                    add_openings((cluster_y + cluster_size - 1) * width + cluster_x, std::min(cluster_size, width - cluster_x), 1, width);
+            }
+        }
+
+        cluster_graph.leg_parents.resize(cluster_graph.node_tiles.size() * cluster_tiles);
+
+        ClusterSearch search;
+        for (const std::vector<int>& nodes : cluster_graph.cluster_nodes)
+        {
+            for (const int node : nodes)
+            {
+                search_cluster(cluster_graph.node_tiles[node], search);
+                std::copy(search.parent.begin(), search.parent.end(), cluster_graph.leg_parents.begin() + node * cluster_tiles);
+                for (const int other : nodes)
+                {
+                    const int distance = search.get_distance(cluster_graph.node_tiles[other]);
+                    if (distance > 0) cluster_graph.edges[node].push_back({other, distance});
                 }
             }
         }
-        //Reset tiles
-        for (TerrainTile* tile : visited)
+    }
+
+    int Terrain::add_cluster_node(const int tile)
+    {
+        if (cluster_graph.tile_nodes[tile] >= 0) return cluster_graph.tile_nodes[tile];
+
+        const int node = (int)cluster_graph.node_tiles.size();
+        cluster_graph.node_tiles.push_back(tile);
+        cluster_graph.edges.emplace_back();
+        cluster_graph.cluster_nodes[get_cluster(tile)].push_back(node);
+        cluster_graph.tile_nodes[tile] = node;
+        return node;
+    }
+
+    int Terrain::get_cluster(const int tile) const
+    {
+        const int cluster_columns = ((int)terrain_width + cluster_size - 1) / cluster_size;
+        return (tile / (int)terrain_width / cluster_size) * cluster_columns + (tile % (int)terrain_width) / cluster_size;
+    }
+
+    void Terrain::search_cluster(const int from, ClusterSearch& search) const
+    {
+        const int width = (int)terrain_width;
+        search.width = width;
+        const int origin_x = (from % width) / cluster_size * cluster_size;
+        const int origin_y = (from / width) / cluster_size * cluster_size;
+        const int end_x = std::min(origin_x + cluster_size, width);
+        const int end_y = std::min(origin_y + cluster_size, (int)terrain_height);
+
+        search.distance.fill(-1);
+        search.distance[cluster_local(from, width)] = 0;
+        search.parent[cluster_local(from, width)] = -1;
+
+        int head = 0;
+        int tail = 0;
+        search.queue[tail++] = from;
+        while (head < tail)
         {
-            tile->visited = false;
+            const int tile = search.queue[head++];
+            const int exit_distance = search.get_distance(tile) + 1;
+
+            for (const TerrainTile* exit : tiles[tile / width][tile % width].exits)
+            {
+                const int exit_x = (int)exit->position_x;
+                const int exit_y = (int)exit->position_y;
+                if (exit_x < origin_x || exit_x >= end_x || exit_y < origin_y || exit_y >= end_y) continue;
+
+                const int exit_index = tile_index(exit);
+                const int local = cluster_local(exit_index, width);
+                if (search.distance[local] >= 0) continue;
+
+                search.distance[local] = exit_distance;
+                search.parent[local] = tile;
+                search.queue[tail++] = exit_index;
+            }
         }
+    }
 
-        if (route_found)
+    int Terrain::get_tile_index(const vec2& position) const
+    {
+        return (int)(position.y / sprite_size) * terrain_width + (int)(position.x / sprite_size);
+    }
+
+    //Breadth-first search backwards from the target, a tile can be entered from any neighbour if it is accessible
+    void Terrain::build_flow_field(const int target_index, FlowField& field) const
+    {
+        field.target = target_index;
+        field.distance.assign(terrain_width * terrain_height, -1);
+
+        const int target_x = target_index % terrain_width;
+        const int target_y = target_index / terrain_width;
+        if (!is_accessible(target_y, target_x)) return;
+
+        //Every tile is queued at most once, so a plain array works as the queue
+        std::vector<int> queue;
+        queue.reserve(terrain_width * terrain_height);
+        queue.push_back(target_index);
+        field.distance[target_index] = 0;
+
+        constexpr int offset_x[4] = {1, -1, 0, 0};
+        constexpr int offset_y[4] = {0, 0, 1, -1};
+
+        for (size_t next = 0; next < queue.size(); next++)
         {
-            //Convert route to vec2 to prevent dangling pointers
-            std::vector<vec2> route;
-            for (const TerrainTile* tile : current_route)
+            const int index = queue[next];
+            const int x = index % terrain_width;
+            const int y = index / terrain_width;
+
+            for (int i = 0; i < 4; i++)
             {
-                route.push_back(vec2(tile->position_x * sprite_size, tile->position_y * sprite_size));
+                const int from_x = x + offset_x[i];
+                const int from_y = y + offset_y[i];
+                if (from_x < 0 || from_x >= (int)terrain_width || from_y < 0 || from_y >= (int)terrain_height) continue;
+
+                const int from_index = from_y * terrain_width + from_x;
+                if (field.distance[from_index] >= 0) continue;
+
+                field.distance[from_index] = field.distance[index] + 1;
+
+                //Tanks can start on a mountain or in water, but can't drive through them
+                if (is_accessible(from_y, from_x))
+                    queue.push_back(from_index);
             }
+        }
+    }
 
-            return route;
+    vector<vec2> Terrain::follow_flow_field(const Tank& tank, const FlowField& field) const
+    {
+        int index = get_tile_index(tank.get_position());
+        if (field.distance[index] < 0)
+        {
+            return std::vector<vec2>();
         }
-        else
+
+        std::vector<vec2> route;
+        route.reserve(field.distance[index] + 1);
+        route.push_back(vec2((float)(index % terrain_width) * sprite_size, (float)(index / terrain_width) * sprite_size));
+
+        //Every tile except the target has an exit one step closer
+        while (index != field.target)
         {
-            return  std::vector<vec2>();
+            const TerrainTile& tile = tiles[index / terrain_width][index % terrain_width];
+            for (const TerrainTile* exit : tile.exits)
+            {
+                const int exit_index = tile_index(exit);
+                if (field.distance[exit_index] == field.distance[index] - 1)
+                {
+                    index = exit_index;
+                    break;
+                }
+            }
+            route.push_back(vec2((float)(index % terrain_width) * sprite_size, (float)(index / terrain_width) * sprite_size));
         }
 
+        return route;
     }
 
     
@@ -26,6 +26,45 @@ namespace Tmpl8
     private:
     };
 
+    //Route search used to plan the tank routes
+    enum class Pathfinder
+    {
+        A_STAR,     //One A* search per tank
+        FLOW_FIELD, //One breadth-first field per distinct target tile, shared by every tank heading there
+        JUMP_POINT,  //One jump point search per tank, A* that skips the straight runs over open terrain
+        HIERARCHICAL //One search per tank over the cluster graph, then refined tile by tile, routes can be a little longer
+    };
+
+    //Distance in tiles from every tile to one target tile, -1 where the target can't be reached
+    struct FlowField
+    {
+        int target = -1;
+        std::vector<int> distance;
+    };
+
+    // -----------------------------------------------------------
+    // Abstract graph for hierarchical search (HPA*)
+    // The grid is split in square clusters, the tiles on both sides of every opening
+    // in a cluster border are the nodes. Nodes on either side of a border are one step apart,
+    // nodes in the same cluster are connected by their distance inside that cluster.
+    // -----------------------------------------------------------
+    struct ClusterGraph
+    {
+        struct Edge
+        {
+            int node;
+            int cost;
+        };
+
+        std::vector<int> node_tiles;                 //Tile index of every node
+        std::vector<std::vector<Edge>> edges;        //Outgoing edges of every node
+        std::vector<std::vector<int>> cluster_nodes; //Nodes that lie in every cluster
+        std::vector<int> tile_nodes;                 //Node of every tile, -1 for tiles that are not one
+        std::vector<int> leg_parents;                //Per node the parent of every tile in its cluster on the way back to it
+    };
+
+    struct ClusterSearch;
+
     class Terrain
     {
     public:
@@ -39,12 +78,31 @@ namespace Tmpl8
         vector<vec2> get_route(const Tank& tank, const vec2& target);
         float get_speed_modifier(const vec2& position) const;
         float get_distance_to_target(const TerrainTile* current_tile, const TerrainTile* destination) const;
-        vector<vec2> a_star(const Tank& tank, const vec2& target);
+        //Reentrant, the search state lives in per thread buffers, so one terrain can serve every thread
+        vector<vec2> a_star(const Tank& tank, const vec2& target) const;
+        //Same route length as a_star, only expands the tiles where a shortest route may turn
+        vector<vec2> jump_point_search(const Tank& tank, const vec2& target) const;
+        //Searches the cluster graph instead of the tiles, a_star stays the reference for the route length
+        vector<vec2> hierarchical_search(const Tank& tank, const vec2& target) const;
+
+        //Tile index of a position, targets with the same index share a flow field
+        int get_tile_index(const vec2& position) const;
+        void build_flow_field(int target_index, FlowField& field) const;
+        //Shortest route from the tank to the target of the field, found by walking down the distances
+        vector<vec2> follow_flow_field(const Tank& tank, const FlowField& field) const;
 
 
     private:
 
         bool is_accessible(int y, int x) const;
+        int jump_horizontal(int x, int y, int direction, int goal) const;
+        int jump_vertical(int x, int y, int direction, int goal) const;
+        void build_cluster_graph();
+        int add_cluster_node(int tile);
+        int get_cluster(int tile) const;
+        //Breadth-first search from the tile that does not leave its cluster
+        void search_cluster(int from, ClusterSearch& search) const;
+        static int tile_index(const TerrainTile* tile) { return (int)tile->position_y * terrain_width + (int)tile->position_x; }
 
         static constexpr int sprite_size = 16;
         static constexpr size_t terrain_width = 80;
@@ -63,5 +121,6 @@ namespace Tmpl8
         std::unique_ptr<Sprite> tile_water;
 
         std::array<std::array<TerrainTile, terrain_width>, terrain_height> tiles;
+        ClusterGraph cluster_graph;
     };
 }
\ No newline at end of file
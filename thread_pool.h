@@ -7,114 +7,398 @@ class ThreadPool; //Forward declare
 
 class Worker;
 
+//What a worker does when it finds no task
+enum class IdlePolicy
+{
+    PARK,            //Sleep on the condition variable right away, costs a wake up of several microseconds
+    SPIN_YIELD_PARK, //Poll for spin_rounds, then yield for yield_rounds, then sleep
+    SPIN             //Keep polling, lowest latency but the core stays busy, only for dedicated machines
+};
+
+struct ThreadPoolConfig
+{
+    //Worker threads, the thread that submits work takes part in parallel_for as well
+    size_t worker_count = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+    IdlePolicy idle_policy = IdlePolicy::PARK;
+    int spin_rounds = 2000;
+    int yield_rounds = 100;
+    //Pin worker i to core i + 1, core 0 is left for the main thread
+    bool pin_workers = false;
+};
+
+// -----------------------------------------------------------
+// Counts the tasks that still have to finish, replaces a future per task
+// Pass it to ThreadPool::enqueue and wait for it with ThreadPool::wait
+// -----------------------------------------------------------
+class TaskLatch
+{
+  public:
+    void add() { pending++; }
+    void count_down() { pending--; }
+    bool done() const { return pending == 0; }
+
+  private:
+    atomic<int> pending = 0;
+};
+
+// -----------------------------------------------------------
+// Task with the callable stored inline, so submitting one does not allocate
+// The callable has to be trivially copyable and fit in storage_size bytes,
+// lambdas that capture pointers, references and numbers do
+// -----------------------------------------------------------
+struct Task
+{
+    static constexpr size_t storage_size = 48;
+
+    void (*invoke)(void* storage) = nullptr;
+    TaskLatch* latch = nullptr;
+    alignas(std::max_align_t) unsigned char storage[storage_size];
+};
+
+// -----------------------------------------------------------
+// Task deque owned by one worker
+// The owner pushes and pops at the back (newest first, its data is still in cache),
+// idle workers steal from the front (oldest first, usually the biggest chunk of work).
+// Every deque has its own lock, so workers only contend when one of them steals.
+// The tasks live in a fixed ring of slots that is reused, pushing fails when it is full.
+// -----------------------------------------------------------
+class WorkQueue
+{
+  public:
+    static constexpr size_t capacity = 1024; //Power of two, the indices wrap with a mask
+
+    WorkQueue() : slots(capacity) {}
+
+    bool push(const Task& task)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (back - front == capacity) return false;
+
+        slots[back++ & (capacity - 1)] = task;
+        return true;
+    }
+
+    bool pop(Task& task)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (back == front) return false;
+
+        task = slots[--back & (capacity - 1)];
+        return true;
+    }
+
+    bool steal(Task& task)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (back == front) return false;
+
+        task = slots[front++ & (capacity - 1)];
+        return true;
+    }
+
+  private:
+    std::mutex mutex;
+    std::vector<Task> slots;
+    size_t front = 0;
+    size_t back = 0;
+};
+
 class Worker
 {
 
   public:
     //Instantiate the worker class by passing and storing the threadpool as a reference
-    Worker(ThreadPool& s) : pool(s) {}
+    Worker(ThreadPool& s, const int index) : pool(s), index(index) {}
 
     inline void operator()();
   private:
     ThreadPool& pool;
+    int index; //Index of the deque this worker owns
 };
 
 class ThreadPool
 {
   private:
     friend class Worker; //Gives access to the private variables of this class
-    const uint max_Threads = std::thread::hardware_concurrency();
+    ThreadPoolConfig config;
     std::vector<std::thread> workers;
-    std::deque<std::function<void()>> tasks;
+    std::unique_ptr<WorkQueue[]> queues; //One per worker, a WorkQueue holds a mutex so it can't live in a vector
+    size_t queue_count = 0;
+
+    //Tasks pushed but not taken yet, workers only go to sleep when this is zero
+    atomic<int> queued_tasks = 0;
+    //Round robin over the deques for tasks enqueued by threads outside the pool
+    atomic<uint> next_queue = 0;
+    //Enqueue only takes the sleep lock to wake a worker when one is (about to go) asleep
+    atomic<int> sleeping_workers = 0;
 
     std::condition_variable condition; //Wakes up a thread when work is available
 
-    std::mutex queue_mutex; //Lock for our queue
-    bool stop = false;
+    std::mutex sleep_mutex; //Lock for sleeping and waking up workers
+    atomic<bool> stop = false;
+
+    //Index of the worker running on this thread, -1 on threads outside the pool
+    inline static thread_local int current_worker = -1;
+
+    void start_workers()
+    {
+        queue_count = config.worker_count;
+        available_threads = (int)config.worker_count;
+        queues.reset(new WorkQueue[queue_count]);
+        for (size_t i = 0; i < queue_count; ++i)
+        {
+            workers.push_back(std::thread(Worker(*this, (int)i)));
+            if (config.pin_workers)
+                pin_to_core(workers.back(), (i + 1) % std::max(std::thread::hardware_concurrency(), 1u));
+        }
+    }
+
+    static void pin_to_core(std::thread& thread, const size_t core)
+    {
+#ifdef _WIN32
+        SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << core);
+#elif defined(__linux__)
+        cpu_set_t cores;
+        CPU_ZERO(&cores);
+        CPU_SET(core, &cores);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(cores), &cores);
+#endif
+    }
+
+    //Workers pop their own deque first and then steal from the others, other threads only steal
+    bool take_task(Task& task)
+    {
+        const int own = current_worker;
+        if (own >= 0 && queues[own].pop(task))
+        {
+            queued_tasks--;
+            return true;
+        }
+
+        const size_t first = (own >= 0) ? own + 1 : 0;
+        for (size_t i = 0; i < queue_count; i++)
+        {
+            const size_t index = (first + i) % queue_count;
+            if ((int)index != own && queues[index].steal(task))
+            {
+                queued_tasks--;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void run_task(Task& task)
+    {
+        task.invoke(task.storage);
+        available_threads++;
+        if (task.latch) task.latch->count_down();
+    }
+
+    //Chunks hold at least grain items, larger ranges get about four chunks per thread so fast threads can take more
+    int chunk_size(const int count, const int grain) const
+    {
+        const int target_chunks = ((int)queue_count + 1) * 4;
+        return std::max(std::max(grain, 1), (count + target_chunks - 1) / target_chunks);
+    }
 
   public:
-      atomic<int> available_threads = std::thread::hardware_concurrency() - 1;
+      atomic<int> available_threads = 0;
       std::mutex mutex_available_threads;
       bool  threads_available() {
           return (available_threads > 0);
       }
 
+    //Workers plus the thread that submits the work
     uint get_thread_count() {
-        return max_Threads;
+        return (uint)config.worker_count + 1;
     }
 
-    ThreadPool(size_t numThreads) : stop(false)
+    ThreadPool(const ThreadPoolConfig& config = {}) : config(config)
     {
-        for (size_t i = 0; i < numThreads; ++i)
-            workers.push_back(std::thread(Worker(*this)));
+        start_workers();
     }
 
-    ThreadPool() : stop(false)
+    ThreadPool(size_t numThreads)
     {
-        for (size_t i = 0; i < (std::thread::hardware_concurrency() - 1); ++i)
-            workers.push_back(std::thread(Worker(*this)));
+        config.worker_count = numThreads;
+        start_workers();
     }
 
     ~ThreadPool()
     {
-        stop = true; // stop all threads
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stop = true; // stop all threads
+        }
         condition.notify_all();
 
         for (auto& thread : workers)
             thread.join();
     }
 
+    //Runs task on a worker, latch (if given) counts it until it is done
     template <class T>
-    auto enqueue(T task) -> std::future<decltype(task())>
+    void enqueue(const T& task, TaskLatch* latch = nullptr)
     {
+        static_assert(sizeof(T) <= Task::storage_size, "Task captures too much, capture a pointer to the data instead");
+        static_assert(std::is_trivially_copyable<T>::value, "Task has to be trivially copyable to be stored inline");
+
         available_threads--;
-        //Wrap the function in a packaged_task so we can return a future object
-        auto wrapper = std::make_shared<std::packaged_task<decltype(task())()>>(std::move(task));
+        if (latch) latch->add();
 
-        //Scope to restrict critical section
+        Task wrapped;
+        wrapped.invoke = [](void* storage) { (*static_cast<T*>(storage))(); };
+        wrapped.latch = latch;
+        new (wrapped.storage) T(task);
+
+        //Tasks spawned by a worker go on its own deque, other threads spread them over the workers
+        const int index = (current_worker >= 0) ? current_worker : (int)(next_queue++ % queue_count);
+        if (!queues[index].push(wrapped))
         {
-            //lock our queue and add the given task to it
-            std::unique_lock<std::mutex> lock(queue_mutex);
+            //Deque is full, running it here still completes it
+            run_task(wrapped);
+            return;
+        }
+        queued_tasks++;
 
-            tasks.push_back([=] {
-                (*wrapper)();
-                pool.available_threads++;
-            });
+        if (sleeping_workers > 0)
+        {
+            //Taking the lock makes sure a worker that just found no work is already waiting before we notify
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+            }
+            //Wake up a thread to start or steal this task
+            condition.notify_one();
         }
+    }
 
-        //Wake up a thread to start this task
-        condition.notify_one();
+    //Runs queued tasks until every task counted by the latch is done, so waiting never blocks a thread
+    void wait(const TaskLatch& latch)
+    {
+        Task task;
+        while (!latch.done())
+        {
+            if (take_task(task))
+                run_task(task);
+            else
+                std::this_thread::yield();
+        }
+    }
 
+    //Number of chunks parallel_for splits [begin, end) in, used to size per chunk buffers before the call
+    int chunk_count(const int begin, const int end, const int grain) const
+    {
+        const int count = end - begin;
+        if (count <= 0) return 0;
 
-        return wrapper->get_future();
+        const int size = chunk_size(count, grain);
+        return (count + size - 1) / size;
+    }
+
+    // -----------------------------------------------------------
+    // Calls function(chunk_begin, chunk_end, chunk) for every chunk of [begin, end)
+    // Chunk indices follow the range order, so per chunk results can be merged in a fixed order.
+    // The calling thread runs chunks as well, helpers are only enqueued while workers are available
+    // and take the next chunk that is left, a helper that starts late finds no chunks left.
+    // -----------------------------------------------------------
+    template <class Function>
+    void parallel_for(const int begin, const int end, const int grain, const Function& function)
+    {
+        const int chunks = chunk_count(begin, end, grain);
+        if (chunks == 0) return;
+        const int size = chunk_size(end - begin, grain);
+
+        atomic<int> next_chunk = 0;
+        const auto run_chunks = [&next_chunk, begin, end, size, chunks, &function]
+        {
+            for (int chunk = next_chunk++; chunk < chunks; chunk = next_chunk++)
+            {
+                const int chunk_begin = begin + chunk * size;
+                function(chunk_begin, std::min(chunk_begin + size, end), chunk);
+            }
+        };
+
+        TaskLatch helpers;
+        for (int helper = 1; helper < chunks; helper++)
+        {
+            std::lock_guard<std::mutex> lock(mutex_available_threads);
+            if (!threads_available()) break;
+            enqueue(run_chunks, &helpers);
+        }
+
+        run_chunks();
+
+        //Every chunk is taken, wait for the helpers still working on one
+        wait(helpers);
+    }
+
+    // -----------------------------------------------------------
+    // Maps every chunk of [begin, end) with map(chunk_begin, chunk_end) and combines the results
+    // in chunk order, so the result does not depend on the thread count for associative combines
+    // -----------------------------------------------------------
+    template <class T, class Map, class Combine>
+    T parallel_reduce(const int begin, const int end, const int grain, const T identity, const Map& map,
+                      const Combine& combine)
+    {
+        std::vector<T> partials(chunk_count(begin, end, grain), identity);
+        parallel_for(begin, end, grain, [&partials, &map](const int chunk_begin, const int chunk_end, const int chunk)
+        {
+            partials[chunk] = map(chunk_begin, chunk_end);
+        });
+
+        T result = identity;
+        for (const T& partial : partials)
+            result = combine(result, partial);
+
+        return result;
     }
 
 };
 
 inline void Worker::operator()()
 {
-    std::function<void()> task;
-    while (true)
-    {
-        //Scope to restrict critical section
-        //This is important because we don't want to hold the lock while executing the task,
-        //because that would make it so only one task can be run simultaneously (aka sequantial)
-        {
-            std::unique_lock<std::mutex> locker(pool.queue_mutex);
+    ThreadPool::current_worker = index;
 
-            //Wait until some work is ready or we are stopping the threadpool
-            //Because of spurious wakeups we need to check if there is actually a task available or we are stopping
-            pool.condition.wait(locker, [=] { return pool.stop || !pool.tasks.empty(); });
+    const ThreadPoolConfig& config = pool.config;
+    int idle_rounds = 0;
 
-            if (pool.stop) break;
+    Task task;
+    while (!pool.stop)
+    {
+        //Reading the counter first keeps an idle worker from locking every deque while it polls
+        if (pool.queued_tasks > 0 && pool.take_task(task))
+        {
+            pool.run_task(task);
+            idle_rounds = 0;
+            continue;
+        }
 
-            task = pool.tasks.front();
-            pool.tasks.pop_front();
+        if (config.idle_policy != IdlePolicy::PARK)
+        {
+            idle_rounds++;
+            if (config.idle_policy == IdlePolicy::SPIN || idle_rounds <= config.spin_rounds)
+            {
+                _mm_pause();
+                continue;
+            }
+            if (idle_rounds <= config.spin_rounds + config.yield_rounds)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            idle_rounds = 0;
         }
 
-        task();
+        //Nothing to pop or steal, sleep until a task is enqueued or we are stopping the threadpool
+        //Because of spurious wakeups we need to check if there is actually a task available or we are stopping
+        std::unique_lock<std::mutex> locker(pool.sleep_mutex);
+        pool.sleeping_workers++;
+        pool.condition.wait(locker, [this] { return pool.stop || pool.queued_tasks > 0; });
+        pool.sleeping_workers--;
     }
-    
+
 }
 
-} // namespace Tmpl8
\ No newline at end of file
+} // namespace Tmpl8